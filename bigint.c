@@ -1,11 +1,9 @@
 /*
  * ToDo:
- *  Parallelize power with omp
  * > bigint_get_binary_string ->  bigint_encode_base2(big, charset, str)
  * > bigint_get_decimal_string ->  bigint_encode_base10
  * > bigint_get_hexadec_string ->  bigint_encode_base16
  * > bigint_encode_base64
- * > bigint_get_prime(nbits) 
  */
 #include <stdio.h>
 #include <string.h>
@@ -14,39 +12,256 @@
 
 #include "bigint.h"
 
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(BIGINT_NO_ASM)
+#define BIGINT_X86_64_KERNELS
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#define OMP_PRAGMA(directive) _Pragma(#directive)
+#else
+#define OMP_PRAGMA(directive)
+#endif
+
 #define STATUS_SUCCESS 0
 #define STATUS_ERROR_BAD_INPUT 0x1
 
-#define NMAX  0xFFFFFFFF
-#define SET1 0x80000000
+#ifdef BIGINT_LIMB64
+typedef uint64_t limb_t;
+typedef unsigned __int128 dlimb_t;
+typedef int64_t slimb_t;
+#define BITSXWORD 64
+#define BXW_MOD_MASK 63
+#define BXW_2K 6
+#define DEC_DIGITS_X_LIMB 19
+#define DEC_LIMB_POW 10000000000000000000ULL
+#else
+typedef uint32_t limb_t;
+typedef uint64_t dlimb_t;
+typedef int32_t slimb_t;
 #define BITSXWORD 32
 #define BXW_MOD_MASK 31
 #define BXW_2K 5
-              /* Notice that for any unsigned integer X:
-	       *    X / 32 = X >> 5  BXW_2K
-               *    X % 32 = X & 31  BXW_MOD_MASK
+#define DEC_DIGITS_X_LIMB 9
+#define DEC_LIMB_POW 1000000000U
+#endif
+              /* The words of struct bigint_s are limbs of BITSXWORD
+	       * bits, 64 when built with -DBIGINT_LIMB64, and dlimb_t
+	       * holds the product of two limbs. bigint_create,
+	       * bigint_get_word and bigint_set_word keep counting 32 bits
+	       * words in both modes. Notice that for any unsigned X:
+	       *    X / BITSXWORD = X >> BXW_2K
+               *    X % BITSXWORD = X & BXW_MOD_MASK
 	       */
 
+#define NMAX ((limb_t) ~(limb_t) 0)
+#define SET1 ((limb_t) 1 << (BITSXWORD - 1))
+
 #define MAX(a,b) (((a)>(b))?(a):(b))
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+#ifndef BIGINT_KARATSUBA_THRESHOLD
+#define BIGINT_KARATSUBA_THRESHOLD (BITSXWORD == 64 ? 40 : 24)
+#endif
+#ifndef BIGINT_SQR_KARATSUBA_THRESHOLD
+#define BIGINT_SQR_KARATSUBA_THRESHOLD (BITSXWORD == 64 ? 64 : 40)
+#endif
+#ifndef BIGINT_TOOM3_THRESHOLD
+#define BIGINT_TOOM3_THRESHOLD (BITSXWORD == 64 ? 256 : 160)
+#endif
+#ifndef BIGINT_TOOM4_THRESHOLD
+#define BIGINT_TOOM4_THRESHOLD (BITSXWORD == 64 ? 512 : 800)
+#endif
+#ifndef BIGINT_NTT_THRESHOLD
+#define BIGINT_NTT_THRESHOLD (BITSXWORD == 64 ? 16384 : 4096)
+#endif
+#ifndef BIGINT_DECIMAL_THRESHOLD
+#define BIGINT_DECIMAL_THRESHOLD 512
+#endif
+#ifndef BIGINT_PRIME_SIEVE
+#define BIGINT_PRIME_SIEVE 4096
+#endif
+#ifndef BIGINT_HGCD_THRESHOLD
+#define BIGINT_HGCD_THRESHOLD 512
+#endif
+#ifndef BIGINT_PARALLEL_THRESHOLD
+#define BIGINT_PARALLEL_THRESHOLD 512
+#endif
+              /* Thresholds count 32 bits words whatever the limb size,
+	       * as bigint_create, rounded up to whole limbs.
+	       * Operands with at least this number of words in the
+	       * shortest factor are multiplied with Karatsuba, Toom-3,
+	       * Toom-4 or number theoretic transforms, smaller ones use
+	       * the schoolbook loop of words_addmul_1. Squares have their
+	       * own Karatsuba threshold since their basecase is cheaper.
+	       * These five are those of the C kernel, bigint_set_kernel
+	       * switches to the ones of kernel_thresholds.
+	       * Decimal strings of numbers from BIGINT_DECIMAL_THRESHOLD
+	       * words, about 16K bits, are split by powers of ten.
+	       * Greatest common divisors reduce the top bits first,
+	       * recursively, from BIGINT_HGCD_THRESHOLD words.
+	       * bigint_get_prime sieves BIGINT_PRIME_SIEVE odd
+	       * candidates at a time. Built with OpenMP and more than one
+	       * thread set, products of at least the square of
+	       * BIGINT_PARALLEL_THRESHOLD words run their subproducts
+	       * and transforms as tasks.
+	       */
+
+#define THRESHOLD_LIMBS(w) ((w) / (BITSXWORD / 32) + \
+			    ((w) % (BITSXWORD / 32) != 0))
+
+#define SMALL_PRIMES 6542      /* Primes below 2^16 */
+
+#define NTT_NPRIMES 3
+#define NTT_MAX_2K 24
+#define NTT_SPAN 4096
+              /* Three primes p = c 2^k + 1 below 2^30 with k >= 24, the
+	       * convolution is recombined with the chinese remainder
+	       * theorem so it holds coefficients up to 2^85. Run as
+	       * tasks, the loops over a transform go in spans of
+	       * NTT_SPAN points.
+	       */
+static const uint32_t ntt_prime[NTT_NPRIMES] = {
+	469762049, 167772161, 754974721
+};
+static const uint32_t ntt_generator[NTT_NPRIMES] = {3, 3, 11};
+
+static const char hex_chars[16] = {
+	'0', '1', '2', '3', '4', '5', '6', '7',
+	'8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+#define IFMA_MASK 0xFFFFFFFFFFFFFULL
+#define IFMA_MAX_DIGITS 128
+#define IFMA_MAX_LIMBS (52 * IFMA_MAX_DIGITS / BITSXWORD)
+#ifdef BIGINT_LIMB64
+#define IFMA_THRESHOLD 24
+#define IFMA_SQR_THRESHOLD 48
+#else
+#define IFMA_THRESHOLD 16
+#define IFMA_SQR_THRESHOLD 16
+#endif
+              /* On x86-64 the product of a word array by one word runs
+	       * on MULX/ADCX/ADOX and, with AVX-512 IFMA, schoolbook
+	       * products with at least IFMA_THRESHOLD words in the
+	       * shortest factor (IFMA_SQR_THRESHOLD for squares) and at
+	       * most IFMA_MAX_DIGITS digits of 52 bits in the longest one
+	       * use the 52 bits multiply-add of eight lanes. The kernel is
+	       * picked from cpuid when the program starts, -DBIGINT_NO_ASM
+	       * keeps the C loops only.
+	       */
+
+#define ARENA_ALIGN 16
+#define ARENA_HEAD ((sizeof(arena_block_t) + ARENA_ALIGN - 1) & \
+		    ~(size_t) (ARENA_ALIGN - 1))
+#define ARENA_BLOCK_WORDS 16384
+              /* Arena blocks are ARENA_BLOCK_WORDS words by default and
+	       * hand out memory aligned to ARENA_ALIGN bytes after their
+	       * header. Requests over a block get a block of their own.
+	       */
+
+#define PROD_LEAF 64
+              /* Product trees of small factors multiply PROD_LEAF of
+	       * them, gathered in limbs, with the schoolbook loop.
+	       */
+
+#define BATCH_LANES 8
+#define BATCH_CHUNK 64
+              /* A batch pads its count of numbers to BATCH_LANES and
+	       * the kernels go over BATCH_CHUNK numbers at a time, so
+	       * the rows of a product stay in the L1 cache.
+	       */
+
+#define BIGINT_INLINE_LIMBS 4
+              /* Numbers up to this number of limbs keep them in the
+	       * struct, bits only moves to the heap (or the arena) when
+	       * bigint_duplicate_words needs more.
+	       */
+
+#define LIMB_POISON ((limb_t) 0xA5A5A5A5A5A5A5A5ULL)
+              /* The limbs of a number from len to words are undefined,
+	       * a kernel zeroes them itself when it needs so. Built with
+	       * -DBIGINT_DEBUG they are filled with LIMB_POISON whenever
+	       * len drops or the capacity grows, so code still expecting
+	       * zeros there gives wrong results in the tests.
+	       */
 
 struct bigint_s {
 	uint32_t words;
 	uint32_t len;
-	uint32_t *bits;
+	limb_t *bits;          /* small or an allocation of words limbs */
+	bigint_arena_t *arena; /* NULL when bits come from malloc */
+	limb_t small[BIGINT_INLINE_LIMBS];
+};
+
+typedef struct arena_block_s {
+	struct arena_block_s *next;
+	size_t size;           /* Bytes, header included */
+	size_t used;
+} arena_block_t;
+
+struct bigint_arena_s {
+	arena_block_t *head;   /* Block being filled */
+	size_t block;          /* Bytes of a new block */
+};
+
+struct bigint_batch_s {
+	uint32_t count;        /* Numbers */
+	uint32_t words;        /* 32 bits words of each number */
+	uint32_t stride;       /* count padded to BATCH_LANES */
+	uint32_t *w;           /* Word i of number j at w[i stride + j] */
+};
+
+typedef struct gcd_matrix_s {
+	bigint_t *m[4];        /* (a; b) = (m0 m1; m2 m3) (a'; b') */
+	int neg;               /* The determinant is -1 */
+} gcd_matrix_t;
+
+struct bigint_barrett_s {
+	uint32_t n;            /* Words of the modulus */
+	uint32_t nmu;          /* Words of the reciprocal */
+	limb_t *m;             /* Modulus */
+	limb_t *mu;            /* floor(B^(2 n) / m) */
+	limb_t *x;             /* 2 n words being reduced */
+	limb_t *q;             /* Products, 4 n + 5 words */
+	limb_t *tmp;           /* Scratch of words_mul */
+	size_t ntmp;
+};
+
+struct bigint_mont_s {
+	uint32_t n;            /* Words of the modulus, R = B^n */
+	limb_t ninv;           /* -m^-1 modulo B */
+	limb_t *m;             /* Odd modulus */
+	limb_t *r2;            /* R^2 mod m */
+	limb_t *a;             /* Padded operands, n words each */
+	limb_t *b;
+	limb_t *t;             /* Products, 2 n + 2 words */
+	limb_t *tmp;           /* Scratch of words_mul */
+	size_t ntmp;
 };
 
 static void reset_flag_nullsafe(int *holder);
 static void set_flag_nullsafe(int *holder, int value);
+static bigint_t *bigint_alloc(uint32_t limbs);
+static bigint_t *bigint_alloc_in(bigint_arena_t *arena, uint32_t limbs);
+static void *arena_alloc(bigint_arena_t *arena, size_t bytes);
+static int arena_grow(bigint_arena_t *arena, void *p, size_t bytes,
+		      size_t more);
 static void bigint_duplicate_words(bigint_t *big, uint32_t minw);
-static uint32_t hex_to_u32(const char *hex, int len);
+static void bigint_resize_limbs(bigint_t *big, uint32_t limbs);
+static void poison_limbs(bigint_t *big, uint32_t from);
 static int digit_hex2int(char c);
-static uint32_t dec_to_u32(const char *dec, int len, uint32_t *pow10);
+static void decimal_parse(bigint_t *big, const char *str, uint32_t n,
+			  bigint_t **pow, int k);
+static void decimal_parse_basecase(bigint_t *big, const char *str, uint32_t n);
 static int digit_decimal(char c);
 static void bigint_update_len(bigint_t *big);
 static uint32_t bigint_get_right_most_on_bit(const bigint_t *big);
 static int has_off_bits(const bigint_t *big);
-static uint32_t index_of_msbit_in_word(uint32_t word);
-static void add_from_word(bigint_t *big, const bigint_t *add, uint32_t w);
+static uint32_t index_of_msbit_in_word(limb_t word);
+static void add_limb(bigint_t *big, limb_t add);
 static void add_N_mul2k(bigint_t *big, const bigint_t *add, uint32_t k);
 static void add_N_div2k(bigint_t *big, const bigint_t *add, uint32_t k);
 static void set_div2k_plus_res2k(bigint_t *big, uint32_t k);
@@ -54,15 +269,240 @@ static void bigint_shift_left_bits(bigint_t *big, uint32_t n);
 static void bigint_shift_left_words(bigint_t *big, uint32_t n);
 static void bigint_shift_right_bits(bigint_t *big, uint32_t n);
 static void bigint_shift_right_words(bigint_t *big, uint32_t n);
-static void add_mul_word(const bigint_t *big, uint32_t word,
+static void add_mul_word(const bigint_t *big, limb_t word,
 			 bigint_t *result, uint32_t i);
-static char char_dec2hex(int n);
-static void reverse_string(char *str, int len);
-static void pow_iterative(bigint_t *big, uint32_t p, bigint_t *aux);
+static char *hex_write_limbs(const limb_t *w, uint32_t n, char *str);
+static char *decimal_split(const bigint_t *big, bigint_t **pow,
+			   bigint_t **inv, int k, char *str, uint32_t width);
+static char *decimal_basecase(const bigint_t *big, char *str, uint32_t width);
+static void bigint_swap(bigint_t *a, bigint_t *b);
+static uint64_t pow_bits(const bigint_t *big, uint64_t p);
+static void pow_binary(bigint_t *big, uint64_t p, bigint_t *aux,
+		       int *status);
+#ifndef BIGINT_LIMB64
 static uint32_t sqrt_u32(uint32_t n, uint32_t *res);
+#endif
 static uint64_t sqrt_u64(uint64_t n, uint64_t *res);
-static uint32_t get_2k_4div_leq(const bigint_t *big);
-static void sqrt_ubig(bigint_t *big, bigint_t *res);
+static void sqrt_rem(bigint_t *s, bigint_t *r, const bigint_t *a);
+static limb_t words_lshift(limb_t *r, const limb_t *a, uint32_t n,
+			   uint32_t s);
+static void words_rshift(limb_t *r, const limb_t *a, uint32_t n,
+			 uint32_t s);
+static limb_t words_divrem_1(limb_t *q, const limb_t *u, uint32_t n,
+			     limb_t d);
+static void words_divrem(limb_t *q, limb_t *u, uint32_t nu,
+			 const limb_t *v, uint32_t nv);
+static void bigint_divrem(bigint_t *q, bigint_t *r, const bigint_t *u,
+			  const bigint_t *v);
+static void bigint_recip(bigint_t *res, const bigint_t *m);
+static limb_t words_add_n_c(limb_t *r, const limb_t *a, const limb_t *b,
+			    uint32_t n, limb_t carry);
+static limb_t words_sub_n_c(limb_t *r, const limb_t *a, const limb_t *b,
+			    uint32_t n, limb_t borrow);
+#ifdef BIGINT_X86_64_KERNELS
+static uint64_t add_n_adc(uint64_t *r, const uint64_t *a, const uint64_t *b,
+			  size_t n4, uint64_t carry);
+static uint64_t sub_n_sbb(uint64_t *r, const uint64_t *a, const uint64_t *b,
+			  size_t n4, uint64_t borrow);
+#endif
+static limb_t words_add_n(limb_t *r, const limb_t *a, const limb_t *b,
+			  uint32_t n);
+static limb_t words_sub_n(limb_t *r, const limb_t *a, const limb_t *b,
+			  uint32_t n);
+static limb_t words_add_1(limb_t *r, const limb_t *a, uint32_t n, limb_t c);
+static limb_t words_sub_1(limb_t *r, const limb_t *a, uint32_t n, limb_t c);
+static limb_t words_add(limb_t *r, const limb_t *a, uint32_t na,
+			const limb_t *b, uint32_t nb);
+static limb_t words_sub(limb_t *r, const limb_t *a, uint32_t na,
+			const limb_t *b, uint32_t nb);
+static limb_t words_addlsh_n(limb_t *r, const limb_t *a, const limb_t *b,
+			     uint32_t n, uint32_t s);
+static limb_t words_sublsh_n(limb_t *r, const limb_t *a, const limb_t *b,
+			     uint32_t n, uint32_t s);
+static limb_t words_addmul_1(limb_t *r, const limb_t *a, uint32_t n,
+			     limb_t word);
+static limb_t words_addmul_1_c(limb_t *r, const limb_t *a, uint32_t n,
+			       limb_t word);
+static limb_t words_submul_1(limb_t *r, const limb_t *a, uint32_t n,
+			     limb_t word);
+#ifdef BIGINT_X86_64_KERNELS
+static uint64_t addmul_1_adx(uint64_t *r, const uint64_t *a, size_t n4,
+			     uint64_t word, uint64_t carry);
+static limb_t words_addmul_1_adx(limb_t *r, const limb_t *a, uint32_t n,
+				 limb_t word);
+static uint32_t ifma_split(uint64_t *x, const limb_t *a, uint32_t n);
+static void words_mul_ifma(limb_t *r, const limb_t *a, uint32_t na,
+			   const limb_t *b, uint32_t nb);
+static int ifma_applies(uint32_t na, uint32_t nb, uint32_t threshold);
+static int cpu_kernel(void);
+static int cpu_avx2(void);
+static void lanes_addmul_avx2(uint32_t *r, const uint32_t *x,
+			      const uint32_t *y, uint32_t *c, uint32_t n);
+static void lanes_addmul_1_avx2(uint32_t *r, const uint32_t *x, uint32_t y,
+				uint32_t *c, uint32_t n);
+#endif
+static void words_mul_basecase(limb_t *r, const limb_t *a, uint32_t na,
+			       const limb_t *b, uint32_t nb);
+static void words_mul_unbalanced(limb_t *r, const limb_t *a, uint32_t na,
+				 const limb_t *b, uint32_t nb, limb_t *tmp);
+static void words_mul_karatsuba(limb_t *r, const limb_t *a, uint32_t na,
+				const limb_t *b, uint32_t nb, limb_t *tmp);
+static int mul_parallel(uint32_t na, uint32_t nb);
+static limb_t *mul_scratch_alloc(uint32_t na, uint32_t nb);
+static void words_mul_spawn(int par, limb_t *r, const limb_t *a,
+			    uint32_t na, const limb_t *b, uint32_t nb,
+			    limb_t *tmp);
+static void tc_mul_spawn(int par, limb_t *r, uint32_t w, limb_t *x,
+			 limb_t *y, uint32_t e, limb_t *tmp);
+static void mul_wait(int par);
+static void words_mul_split(limb_t *r, const limb_t *a, uint32_t na,
+			    const limb_t *b, uint32_t nb);
+static void words_mul_top(limb_t *r, const limb_t *a, uint32_t na,
+			  const limb_t *b, uint32_t nb, limb_t *tmp);
+static void tc_neg(limb_t *x, uint32_t w);
+static void tc_shl(limb_t *r, const limb_t *x, uint32_t w, uint32_t n);
+static void tc_shr(limb_t *x, uint32_t w, uint32_t n);
+static void tc_divexact_1(limb_t *x, uint32_t w, uint32_t d);
+static void tc_mul(limb_t *r, uint32_t w, limb_t *x, limb_t *y,
+		   uint32_t e, limb_t *tmp);
+static void add_at(limb_t *r, uint32_t nr, uint32_t off,
+		   const limb_t *c, uint32_t w);
+static void toom_parts_len(uint32_t n, uint32_t k, uint32_t np,
+			   uint32_t *len);
+static void toom3_eval(limb_t *ev, uint32_t e, const limb_t *a,
+		       uint32_t k, const uint32_t *len);
+static void toom4_eval(limb_t *ev, uint32_t e, const limb_t *a,
+		       uint32_t k, const uint32_t *len);
+static void words_mul_toom3(limb_t *r, const limb_t *a, uint32_t na,
+			    const limb_t *b, uint32_t nb, limb_t *tmp);
+static void words_mul_toom4(limb_t *r, const limb_t *a, uint32_t na,
+			    const limb_t *b, uint32_t nb, limb_t *tmp);
+static uint32_t ntt_piece_bits(uint32_t na, uint32_t nb);
+static uint32_t ntt_length(uint32_t na, uint32_t nb, uint32_t pbits);
+static uint32_t mod_pow_u32(uint32_t b, uint32_t e, uint32_t p);
+static uint32_t mont_redc(uint64_t t, uint32_t p, uint32_t pinv);
+static void ntt_load(uint32_t *x, uint32_t n, const limb_t *a,
+		     uint32_t na, uint32_t pbits, uint32_t p, int par);
+static void ntt_forward_span(uint32_t *x, const uint32_t *w, uint32_t len,
+			     uint32_t st, uint32_t p, uint32_t pinv,
+			     uint32_t i, uint32_t end);
+static void ntt_inverse_span(uint32_t *x, const uint32_t *w, uint32_t half,
+			     uint32_t len, uint32_t st, uint32_t p,
+			     uint32_t pinv, uint32_t i, uint32_t end);
+static void ntt_forward(uint32_t *x, uint32_t n, const uint32_t *w,
+			uint32_t p, uint32_t pinv, int par);
+static void ntt_inverse(uint32_t *x, uint32_t n, const uint32_t *w,
+			uint32_t p, uint32_t pinv, int par);
+static void ntt_convolution(uint32_t *x, uint32_t *y, uint32_t *w,
+			   uint32_t n, int ip, const limb_t *a, uint32_t na,
+			   const limb_t *b, uint32_t nb, uint32_t pbits,
+			   int par);
+static void words_mul_ntt(limb_t *r, const limb_t *a, uint32_t na,
+			  const limb_t *b, uint32_t nb, limb_t *tmp);
+static void words_mul(limb_t *r, const limb_t *a, uint32_t na,
+		      const limb_t *b, uint32_t nb, limb_t *tmp);
+static size_t mul_scratch_words(uint32_t na, uint32_t nb);
+static void words_sqr_basecase(limb_t *r, const limb_t *a, uint32_t n);
+static void words_sqr_karatsuba(limb_t *r, const limb_t *a, uint32_t n,
+				limb_t *tmp);
+static void words_sqr(limb_t *r, const limb_t *a, uint32_t n,
+		      limb_t *tmp);
+static int words_cmp(const limb_t *a, const limb_t *b, uint32_t n);
+static void barrett_reserve(bigint_barrett_t *ctx, uint32_t na, uint32_t nb);
+static void barrett_reduce_x(bigint_barrett_t *ctx);
+static void barrett_store_x(bigint_barrett_t *ctx, bigint_t *big);
+static void barrett_mul_words(bigint_barrett_t *ctx, limb_t *r,
+			      const limb_t *a, const limb_t *b);
+static void store_words(bigint_t *big, const limb_t *w, uint32_t n);
+static void load_words(limb_t *w, uint32_t n, const bigint_t *big);
+static void mont_reserve(bigint_mont_t *ctx);
+static void mont_reduce_words(bigint_mont_t *ctx, limb_t *r, limb_t *t);
+static void mont_mul_words(bigint_mont_t *ctx, limb_t *r,
+			   const limb_t *a, const limb_t *b);
+static void mont_sqr_words(bigint_mont_t *ctx, limb_t *r,
+			   const limb_t *a);
+static uint32_t powmod_window(uint32_t bits);
+static void powmod_words(bigint_mont_t *mont, bigint_barrett_t *barrett,
+			 limb_t *acc, const limb_t *g, const bigint_t *exp);
+static uint64_t gcd_u64(uint64_t a, uint64_t b);
+static dlimb_t gcd_top(const bigint_t *big, uint32_t h);
+static uint32_t gcd_lehmer_q(const bigint_t *a, const bigint_t *b,
+			     uint32_t s, limb_t *x);
+static limb_t gcd_combine(bigint_t *r, const bigint_t *a, limb_t x,
+			  const bigint_t *b, limb_t y, int sub);
+static int gcd_apply(bigint_t *a, bigint_t *b, const limb_t *x, int neg,
+		     bigint_t **t);
+static int gcd_apply_matrix(bigint_t *a, bigint_t *b, const gcd_matrix_t *q,
+			    bigint_t **t);
+static void gcd_matrix_init(gcd_matrix_t *m, uint32_t limbs);
+static void gcd_matrix_free(gcd_matrix_t *m);
+static void gcd_matrix_mul_q(gcd_matrix_t *m, const limb_t *x, int neg,
+			     bigint_t **t);
+static void gcd_matrix_mul_div(gcd_matrix_t *m, const bigint_t *q,
+			       bigint_t *t);
+static void gcd_matrix_mul(gcd_matrix_t *m, const gcd_matrix_t *q,
+			   bigint_t **t);
+static void gcd_half(bigint_t *a, bigint_t *b, uint32_t s, gcd_matrix_t *m);
+static void small_primes_init(void);
+static uint32_t small_primes_group(uint32_t i, uint32_t np, limb_t *prod);
+static int small_primes_divide(const bigint_t *big, uint32_t np);
+static void small_primes_mod(const bigint_t *big, uint32_t np, uint32_t *res);
+static int miller_rabin(const bigint_t *big, uint32_t rounds);
+static uint32_t prime_rounds(uint32_t bits);
+static uint64_t rng_default(void);
+static uint32_t *primes_upto(uint32_t n, uint32_t *np);
+static void prod_leaf_u32(const uint32_t *u, uint32_t n, bigint_t *result);
+static void prod_tree(const bigint_t *const *v, const uint32_t *u, uint32_t n,
+		      bigint_t *result, int par);
+static void prod_top(const bigint_t *const *v, const uint32_t *u, uint32_t n,
+		     uint64_t words, bigint_t *result);
+static uint32_t prime_swing(uint32_t n, const uint32_t *primes,
+			    uint32_t np, uint32_t *f);
+static void lanes_addmul(uint32_t *r, const uint32_t *x, const uint32_t *y,
+			 uint32_t *c, uint32_t n);
+static void lanes_addmul_1(uint32_t *r, const uint32_t *x, uint32_t y,
+			   uint32_t *c, uint32_t n);
+static void lanes_set_carry(uint32_t *r, const uint32_t *c, uint32_t n);
+static void batch_redc(uint32_t *r, uint32_t *t, const uint32_t *m,
+		       uint32_t ninv, uint32_t n, uint32_t lanes);
+static int batch_below(const bigint_batch_t *a, uint32_t j,
+		       const uint32_t *m, uint32_t n);
+static bigint_batch_t *batch_reduce(const bigint_batch_t *a,
+				    const bigint_t *mod, const uint32_t *m,
+				    uint32_t n);
+
+static uint32_t karatsuba_threshold =
+	THRESHOLD_LIMBS(BIGINT_KARATSUBA_THRESHOLD);
+static uint32_t toom3_threshold = THRESHOLD_LIMBS(BIGINT_TOOM3_THRESHOLD);
+static uint32_t toom4_threshold = THRESHOLD_LIMBS(BIGINT_TOOM4_THRESHOLD);
+static uint32_t ntt_threshold = THRESHOLD_LIMBS(BIGINT_NTT_THRESHOLD);
+static uint32_t sqr_karatsuba_threshold =
+	THRESHOLD_LIMBS(BIGINT_SQR_KARATSUBA_THRESHOLD);
+static uint32_t decimal_threshold = THRESHOLD_LIMBS(BIGINT_DECIMAL_THRESHOLD);
+static uint32_t hgcd_threshold = THRESHOLD_LIMBS(BIGINT_HGCD_THRESHOLD);
+static uint32_t parallel_threshold = THRESHOLD_LIMBS(BIGINT_PARALLEL_THRESHOLD);
+static uint32_t num_threads = 1;
+static const uint32_t kernel_thresholds[3][5] = {
+	/* Karatsuba, square Karatsuba, Toom-3, Toom-4 and transform
+	 * thresholds of the C, ADX and IFMA kernels. The faster the
+	 * basecase the later the splits pay, IFMA keeps the products it
+	 * takes, up to IFMA_MAX_LIMBS, and ADX skips Toom-3.
+	 */
+	{BIGINT_KARATSUBA_THRESHOLD, BIGINT_SQR_KARATSUBA_THRESHOLD,
+	 BIGINT_TOOM3_THRESHOLD, BIGINT_TOOM4_THRESHOLD, BIGINT_NTT_THRESHOLD},
+#ifdef BIGINT_LIMB64
+	{80, 256, 768, 768, 131072},
+	{209, 224, 1024, 4096, 262144}
+#else
+	{112, 192, 768, 768, 16384},
+	{209, 209, 1024, 4096, 65536}
+#endif
+};
+static uint16_t small_primes[SMALL_PRIMES];
+static int mul_kernel = BIGINT_KERNEL_C;
+#ifdef BIGINT_X86_64_KERNELS
+static int lanes_avx2;
+#endif
 
 static void reset_flag_nullsafe(int *holder)
 {
@@ -76,106 +516,263 @@ static void set_flag_nullsafe(int *holder, int value)
 		*holder |= value;
 }
 
-bigint_t* bigint_create(uint32_t words)
+static bigint_t *bigint_alloc(uint32_t limbs)
+{
+	return bigint_alloc_in(NULL, limbs);
+}
+
+static bigint_t *bigint_alloc_in(bigint_arena_t *arena, uint32_t limbs)
 {
-	if  (words < 4)
-		words = 4;
-	bigint_t *big = (bigint_t*) malloc(sizeof(*big));
+	if  (limbs < BIGINT_INLINE_LIMBS)
+		limbs = BIGINT_INLINE_LIMBS;
+	bigint_t *big;
+	if (arena)
+		big = arena_alloc(arena, sizeof(*big));
+	else
+		big = (bigint_t*) malloc(sizeof(*big));
+	if (limbs == BIGINT_INLINE_LIMBS)
+		big->bits = big->small;
+	else if (arena)
+		big->bits = arena_alloc(arena, limbs * sizeof(limb_t));
+	else
+		big->bits = malloc(limbs * sizeof(limb_t));
 	big->len = 0;
-	big->words = words;
-	big->bits = malloc(words * sizeof(uint32_t));
-	memset(big->bits, 0, words * sizeof(uint32_t));
+	big->words = limbs;
+	big->arena = arena;
+	poison_limbs(big, big->len);
 	return big;
 }
 
+bigint_t* bigint_create(uint32_t words)
+{
+	/* words counts 32 bits words whatever the limb size */
+	uint32_t per = BITSXWORD / 32;
+	return bigint_alloc(words / per + (words % per != 0));
+}
+
+bigint_t *bigint_create_in(bigint_arena_t *arena, uint32_t words)
+{
+	/* Released with the arena, bigint_destroy does nothing on it */
+	uint32_t per = BITSXWORD / 32;
+	return bigint_alloc_in(arena, words / per + (words % per != 0));
+}
+
+bigint_arena_t *bigint_arena_create(uint32_t words)
+{
+	/* words is the size of each block in 32 bits words, 0 for the
+	 * default one. Blocks are only malloc'ed when needed.
+	 */
+	bigint_arena_t *arena = malloc(sizeof(*arena));
+	if (!words)
+		words = ARENA_BLOCK_WORDS;
+	arena->head = NULL;
+	arena->block = ARENA_HEAD + (size_t) words * sizeof(uint32_t);
+	return arena;
+}
+
+void bigint_arena_destroy(bigint_arena_t *arena)
+{
+	if (!arena)
+		return;
+	while (arena->head) {
+		arena_block_t *next = arena->head->next;
+		free(arena->head);
+		arena->head = next;
+	}
+	free(arena);
+}
+
+static void *arena_alloc(bigint_arena_t *arena, size_t bytes)
+{
+	bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+	arena_block_t *b = arena->head;
+	if (b && b->used + bytes <= b->size) {
+		void *p = (char*) b + b->used;
+		b->used += bytes;
+		return p;
+	}
+
+	/* A request over a block gets its own one, kept behind the
+	 * block being filled.
+	 */
+	size_t size = MAX(arena->block, ARENA_HEAD + bytes);
+	arena_block_t *nb = malloc(size);
+	nb->size = size;
+	nb->used = ARENA_HEAD + bytes;
+	if (b && size > arena->block) {
+		nb->next = b->next;
+		b->next = nb;
+	} else {
+		nb->next = b;
+		arena->head = nb;
+	}
+	return (char*) nb + ARENA_HEAD;
+}
+
+static int arena_grow(bigint_arena_t *arena, void *p, size_t bytes,
+		      size_t more)
+{
+	/* Extends the last allocation p of bytes in place, returns 0 if
+	 * it is not the last one or the block is full.
+	 */
+	arena_block_t *b = arena->head;
+	bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+	more = (more + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+	if (!b || (char*) p + bytes != (char*) b + b->used ||
+	    b->used + more > b->size)
+		return 0;
+	b->used += more;
+	return 1;
+}
+
 static void bigint_duplicate_words(bigint_t *big, uint32_t minw)
 {
 	uint32_t w2 = 2 * big->words;
 	while (w2 < minw)
 		w2 *= 2;
-	uint32_t *aux = malloc(big->words * sizeof(uint32_t));
-	memcpy(aux, big->bits, big->words * sizeof(uint32_t));
-	free(big->bits);
-	big->bits = malloc(w2 * sizeof(uint32_t));
-	memcpy(big->bits, aux, big->words * sizeof(uint32_t));
-	memset(big->bits + big->words, 0, (w2 - big->words) * sizeof(uint32_t));
-	big->words = w2;
-	free(aux);
+	bigint_resize_limbs(big, w2);
+}
+
+static void bigint_resize_limbs(bigint_t *big, uint32_t limbs)
+{
+	/* Sets the capacity of big to limbs >= len, with a single copy
+	 * at most. Up to BIGINT_INLINE_LIMBS they go back to the struct.
+	 * Arena limbs are not shrunk otherwise, the arena cannot reuse
+	 * them anyway.
+	 */
+	if (limbs <= BIGINT_INLINE_LIMBS) {
+		if (big->bits != big->small) {
+			memcpy(big->small, big->bits, big->len * sizeof(limb_t));
+			if (!big->arena)
+				free(big->bits);
+			big->bits = big->small;
+		}
+		big->words = BIGINT_INLINE_LIMBS;
+		poison_limbs(big, big->len);
+		return;
+	}
+	if (big->arena && limbs <= big->words)
+		return;
+
+	size_t old = big->words * sizeof(limb_t);
+	size_t size = limbs * sizeof(limb_t);
+	if (big->bits == big->small) {
+		limb_t *bits = big->arena ? arena_alloc(big->arena, size) :
+			malloc(size);
+		memcpy(bits, big->small, old);
+		big->bits = bits;
+	} else if (!big->arena) {
+		big->bits = realloc(big->bits, size);
+	} else if (!arena_grow(big->arena, big->bits, old, size - old)) {
+		/* The old limbs stay in the arena until it is destroyed */
+		limb_t *bits = arena_alloc(big->arena, size);
+		memcpy(bits, big->bits, old);
+		big->bits = bits;
+	}
+	uint32_t words = big->words;
+	big->words = limbs;
+	poison_limbs(big, MIN(words, limbs));
+}
+
+static void poison_limbs(bigint_t *big, uint32_t from)
+{
+#ifdef BIGINT_DEBUG
+	for (uint32_t i = from; i < big->words; i++)
+		big->bits[i] = LIMB_POISON;
+#else
+	(void) big;
+	(void) from;
+#endif
+}
+
+void bigint_reserve(bigint_t *big, uint32_t words)
+{
+	/* Room for at least words 32 bits words, as bigint_create */
+	uint32_t per = BITSXWORD / 32;
+	uint32_t limbs = words / per + (words % per != 0);
+	if (limbs > big->words)
+		bigint_resize_limbs(big, limbs);
+}
+
+void bigint_shrink_to_fit(bigint_t *big)
+{
+	bigint_resize_limbs(big, big->len);
+}
+
+uint32_t bigint_capacity(const bigint_t *big)
+{
+	/* In 32 bits words, as bigint_create */
+	return big->words * (BITSXWORD / 32);
 }
 
 void bigint_destroy(bigint_t *big)
 {
-	if (big->words)
+	if (big->arena)
+		return;
+	if (big->bits != big->small)
 		free(big->bits);
 	free(big);
 }
 
 bigint_t* bigint_clone(const bigint_t *src)
 {
-	bigint_t *big = bigint_create(src->words);
+	bigint_t *big = bigint_alloc(src->words);
 	big->len = src->len;
 	if (src->len)
-		memcpy(big->bits, src->bits, src->len * sizeof(uint32_t));
+		memcpy(big->bits, src->bits, src->len * sizeof(limb_t));
 	return big;
 }
 
 void bigint_set_u32(bigint_t *big, uint32_t a)
 {
-	if (big->len)
-		memset(big->bits, 0, big->len * sizeof(uint32_t));
-
 	if (a) {
 		big->bits[0] = a;
 		big->len = 1;
 	} else {
 		big->len = 0;
 	}
+	poison_limbs(big, big->len);
 }
 
 void bigint_set_u64(bigint_t *big, uint64_t a)
 {
-	if (big->len)
-		memset(big->bits, 0, big->len * sizeof(uint32_t));
-
 	if (a) {
-		big->bits[0] = (uint32_t) a;
+		big->bits[0] = (limb_t) a;
 		big->len = 1;
+#ifndef BIGINT_LIMB64
 		a >>= BITSXWORD;
 		if (a) {
-			big->bits[1] = (uint32_t) a;
+			big->bits[1] = (limb_t) a;
 			big->len = 2;
 		}
+#endif
 	} else {
 		big->len = 0;
 	}
+	poison_limbs(big, big->len);
 }
 void bigint_set_hexadec(bigint_t *big, const char *hexadec)
 {
-	int i = 0;
+	/* Every BITSXWORD / 4 digits from the end of the string fill
+	 * one limb.
+	 */
+	uint32_t n = strlen(hexadec);
+	uint32_t limbs = (n + BITSXWORD / 4 - 1) / (BITSXWORD / 4);
 	bigint_set_u32(big, 0);
-	while (1) {
-		int len = 0;
-		while (hexadec[i + len] != '\0' && len < 7)
-			len ++;
-		if (!len)
-			break;
-		
-		const char *c = hexadec + i;
-		uint32_t d = hex_to_u32(c, len);
-		bigint_shift_left(big, 4 * len);
-		bigint_add_u32(big, d);
-		i += len;
-	}
-}
+	if (big->words < limbs)
+		bigint_duplicate_words(big, limbs);
 
-static uint32_t hex_to_u32(const char *hex, int len)
-{
-	uint32_t val = 0;
-	for (int i = 0; i < len; i++) {
-		val <<= 4;
-		val += digit_hex2int(hex[i]);
+	const char *c = hexadec + n;
+	for (uint32_t i = 0; i < limbs; i++) {
+		limb_t w = 0;
+		uint32_t m = MIN(c - hexadec, BITSXWORD / 4);
+		c -= m;
+		for (uint32_t j = 0; j < m; j++)
+			w = (w << 4) | digit_hex2int(c[j]);
+		big->bits[i] = w;
 	}
-	return val;
+	big->len = limbs;
+	bigint_update_len(big);
 }
 
 static int digit_hex2int(char c)
@@ -190,37 +787,98 @@ static int digit_hex2int(char c)
 		return 0; // Report this error
 }
 
-void bigint_set_decimal(bigint_t *big, const char *decimal, bigint_t *aux)
+void bigint_set_decimal(bigint_t *big, const char *decimal, int *status)
 {
-	int i = 0;
+	/* STATUS_ERROR_BAD_INPUT and big at zero if decimal has other
+	 * chars than digits.
+	 */
+	reset_flag_nullsafe(status);
+
+	uint32_t n = strlen(decimal);
 	bigint_set_u32(big, 0);
-	while (1) {
-		int len = 0;
-		while (decimal[i + len] != '\0' && len < 8)
-			len ++;
-		if (!len)
-			break;
-		
-		const char *c = decimal + i;
-		uint32_t pow10 = 1;
-		uint32_t d = dec_to_u32(c, len, &pow10);
-		bigint_copy(aux, big);
-		bigint_mul_u32(aux, pow10, big);
-		bigint_add_u32(big, d);
-		i += len;
+	for (uint32_t i = 0; i < n; i++) {
+		if (digit_decimal(decimal[i]) < 0) {
+			set_flag_nullsafe(status, STATUS_ERROR_BAD_INPUT);
+			return;
+		}
+	}
+	if (n / DEC_DIGITS_X_LIMB < decimal_threshold) {
+		decimal_parse_basecase(big, decimal, n);
+		return;
+	}
+
+	/* pow[k] = 10^(d 2^k) while d 2^k is below the digits */
+	bigint_t *pow[32];
+	int k = 0;
+	pow[0] = bigint_alloc(1);
+	add_limb(pow[0], DEC_LIMB_POW);
+	while ((uint64_t) DEC_DIGITS_X_LIMB << (k + 1) < n) {
+		pow[k + 1] = bigint_alloc(2 * pow[k]->len);
+		bigint_sqr(pow[k], pow[k + 1]);
+		k ++;
+	}
+
+	decimal_parse(big, decimal, n, pow, k);
+
+	for (int i = 0; i <= k; i++)
+		bigint_destroy(pow[i]);
+}
+
+static void decimal_parse(bigint_t *big, const char *str, uint32_t n,
+			  bigint_t **pow, int k)
+{
+	/* big <- the n digits of str as high * pow[k] + low, with k the
+	 * largest power of less than n digits and low its last d 2^k
+	 * digits.
+	 */
+	while (k >= 0 && (uint64_t) DEC_DIGITS_X_LIMB << k >= n)
+		k --;
+	if (k < 0 || n / DEC_DIGITS_X_LIMB < decimal_threshold) {
+		decimal_parse_basecase(big, str, n);
+		return;
 	}
+
+	uint32_t low = DEC_DIGITS_X_LIMB << k;
+	bigint_t *hi = bigint_alloc((n - low) / DEC_DIGITS_X_LIMB + 1);
+	bigint_t *lo = bigint_alloc(low / DEC_DIGITS_X_LIMB + 1);
+	decimal_parse(hi, str, n - low, pow, k - 1);
+	decimal_parse(lo, str + n - low, low, pow, k - 1);
+	bigint_mul(hi, pow[k], big);
+	bigint_add(big, lo);
+	bigint_destroy(hi);
+	bigint_destroy(lo);
 }
 
-static uint32_t dec_to_u32(const char *dec, int len, uint32_t *pow10)
+static void decimal_parse_basecase(bigint_t *big, const char *str, uint32_t n)
 {
-	*pow10 = 1;
-	uint32_t val = 0;
-	for (int i = 0; i < len; i++) {
-		(*pow10) *= 10;
-		val *= 10;
-		val += digit_decimal(dec[i]);
+	/* big <- big 10^d + the next d digits, the first chunk takes the
+	 * n % d leading digits.
+	 */
+	uint32_t limbs = n / DEC_DIGITS_X_LIMB + 1;
+	if (big->words < limbs)
+		bigint_duplicate_words(big, limbs);
+	bigint_set_u32(big, 0);
+
+	uint32_t len = 0;
+	uint32_t m = n % DEC_DIGITS_X_LIMB;
+	if (!m)
+		m = DEC_DIGITS_X_LIMB;
+	for (uint32_t i = 0; i < n; i += m, m = DEC_DIGITS_X_LIMB) {
+		limb_t pow10 = 1;
+		dlimb_t carry = 0;
+		for (uint32_t j = 0; j < m; j++) {
+			pow10 *= 10;
+			carry = carry * 10 + (str[i + j] - 48);
+		}
+		for (uint32_t j = 0; j < len; j++) {
+			carry += (dlimb_t) big->bits[j] * pow10;
+			big->bits[j] = (limb_t) carry;
+			carry >>= BITSXWORD;
+		}
+		if (carry)
+			big->bits[len ++] = (limb_t) carry;
 	}
-	return val;
+	big->len = len;
 }
 
 static int digit_decimal(char c)
@@ -228,24 +886,18 @@ static int digit_decimal(char c)
 	if (c > 47 && c < 58)
 		return c - 48;
 	else
-		return 0; /* Report this error */
+		return -1;
 }
 
 void bigint_copy(bigint_t *big, const bigint_t *src)
 {
-	if (big->words < src->len) {
-		free(big->bits);
-		big->words = src->words;
-		big->bits = malloc(big->words * sizeof(uint32_t));
-                /* Next line can be removed? */
-		memset(big->bits, 0, big->words * sizeof(uint32_t));
-	} else {
-                /* Next line can be removed? */
-		memset(big->bits, 0, big->len * sizeof(uint32_t));
-	}
+	big->len = 0;
+	if (big->words < src->len)
+		bigint_duplicate_words(big, src->len);
 	if (src->len)
-		memcpy(big->bits, src->bits, src->len * sizeof(uint32_t));
+		memcpy(big->bits, src->bits, src->len * sizeof(limb_t));
 	big->len = src->len;
+	poison_limbs(big, big->len);
 }
 
 static void bigint_update_len(bigint_t *big)
@@ -255,6 +907,7 @@ static void bigint_update_len(bigint_t *big)
 			break;
 		big->len -= 1;
 	}
+	poison_limbs(big, big->len);
 }
 
 static uint32_t bigint_get_right_most_on_bit(const bigint_t *big)
@@ -264,7 +917,7 @@ static uint32_t bigint_get_right_most_on_bit(const bigint_t *big)
 		while (!big->bits[ix])
 			ix ++;
 	
-		uint32_t w = big->bits[ix];
+		limb_t w = big->bits[ix];
 		ix = ix << BXW_2K;
 		while (!(w & 1)) {
 			ix ++;
@@ -283,10 +936,9 @@ int bigint_is_zero(const bigint_t *big)
 
 int bigint_gt(const bigint_t *big, uint32_t gt)
 {
-	// @vecn: CHECK THIS FUNCTION
 	if (big->len > 1)
 		return 1;
-	else if (big->bits[0] > gt)
+	else if (big->len && big->bits[0] > gt)
 		return 1;
 	else
 		return 0;
@@ -294,16 +946,18 @@ int bigint_gt(const bigint_t *big, uint32_t gt)
 
 void bigint_set_max(bigint_t *big)
 {
-	memset(big->bits, 0xFF, big->words * sizeof(uint32_t));
+	memset(big->bits, 0xFF, big->words * sizeof(limb_t));
 	big->len = big->words;
 }
 
 void bigint_set_lsbit(bigint_t *big)
 {
-	if (big->len == 0)
+	if (big->len == 0) {
+		big->bits[0] = 1;
 		big->len = 1;
-
-	big->bits[0] |= 1;
+	} else {
+		big->bits[0] |= 1;
+	}
 }
 
 int bigint_get_lsbit(const bigint_t *big)
@@ -319,7 +973,7 @@ uint32_t bigint_count_on_bits(const bigint_t *big)
 	uint32_t count = 0;
 	int h[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
 	for (int i = 0; i < big->len; i++) {
-		uint32_t word = big->bits[i];
+		limb_t word = big->bits[i];
 		while (word) {
 			count += h[word & 15];
 			word >>= 4;
@@ -333,7 +987,7 @@ int bigint_is_2k(const bigint_t *big)
 	uint32_t count = 0;
 	int h[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
 	for (int i = 0; i < big->len; i++) {
-		uint32_t word = big->bits[i];
+		limb_t word = big->bits[i];
 		while (word) {
 			count += h[word & 15];
 			word >>= 4;
@@ -346,8 +1000,10 @@ int bigint_is_2k(const bigint_t *big)
 
 int bigint_get_word(const bigint_t *big, int i, uint32_t *word)
 {
-	if (i < big->len) {
-		*word = big->bits[i];
+	/* Word i holds the bits [32 i, 32 i + 32) of big */
+	uint32_t per = BITSXWORD / 32;
+	if (i < big->len * per) {
+		*word = (uint32_t) (big->bits[i / per] >> (32 * (i % per)));
 		return 1;
 	} else {
 		*word = 0;
@@ -357,11 +1013,18 @@ int bigint_get_word(const bigint_t *big, int i, uint32_t *word)
 
 void bigint_set_word(bigint_t *big, int i, uint32_t word)
 {
+	uint32_t per = BITSXWORD / 32;
+	uint32_t shift = 32 * (i % per);
+	i /= per;
 	if (i >= big->words)
 		bigint_duplicate_words(big, i + 1);
-	
-	big->bits[i] = word;
-	if (word) {
+	if (i >= big->len)
+		memset(big->bits + big->len, 0,
+		       (i + 1 - big->len) * sizeof(limb_t));
+
+	big->bits[i] &= ~((limb_t) 0xFFFFFFFF << shift);
+	big->bits[i] |= (limb_t) word << shift;
+	if (big->bits[i]) {
 	    if (big->len < i + 1)
 		big->len = i + 1;
 	} else {
@@ -388,17 +1051,29 @@ int bigint_compare_u32(const bigint_t *big, uint32_t n)
     
 int bigint_compare_u64(const bigint_t *big, uint64_t n)
 {
+#ifdef BIGINT_LIMB64
+	if (big->len > 1)
+		return 1;
+	else if (big->len == 0)
+		return n ? -1 : 0;
+	else if (big->bits[0] > n)
+		return 1;
+	else if (big->bits[0] < n)
+		return -1;
+	else
+		return 0;
+#else
 	if (big->len > 2)
 		return 1;
 
 	if (big->len == 2) {
-		uint32_t aux = (n >> BITSXWORD);
+		uint32_t aux = (n >> 32);
 		if (big->bits[1] > aux) {
 			return 1;
 		} else if (big->bits[1] < aux) {
 			return -1;
 		} else {
-			aux = n & NMAX;
+			aux = n & 0xFFFFFFFF;
 			if (big->bits[0] > aux)
 				return 1;
 			else if (big->bits[0] < aux)
@@ -408,13 +1083,14 @@ int bigint_compare_u64(const bigint_t *big, uint64_t n)
 		}
 	}
 	if (big->len < 2) {
-		uint32_t aux = (n >> BITSXWORD);
+		uint32_t aux = (n >> 32);
 		if (aux > 0)
 			return -1;
 		else
-			return bigint_compare_u32(big, n & NMAX);
+			return bigint_compare_u32(big, n & 0xFFFFFFFF);
 
 	}
+#endif
 }
 
 int bigint_compare_2k(const bigint_t *big, uint32_t bit)
@@ -429,7 +1105,7 @@ int bigint_compare_2k(const bigint_t *big, uint32_t bit)
 		return 1;
 	}
 	
-	uint32_t word_2k = 1U << (bit & BXW_MOD_MASK);
+	limb_t word_2k = (limb_t) 1 << (bit & BXW_MOD_MASK);
 	if (word_2k > big->bits[big->len - 1]) {
 		return -1;
 	} else if (word_2k < big->bits[big->len - 1]) {
@@ -468,7 +1144,7 @@ static int has_off_bits(const bigint_t *big)
 		if (big->bits[i] < NMAX)
 			return 1;
 	}
-	uint32_t word = big->bits[i];
+	limb_t word = big->bits[i];
 	while (word) {
 		if (!(word & 1U))
 			return 1;
@@ -494,28 +1170,25 @@ int bigint_compare(const bigint_t *a, const bigint_t *b)
 	}
 }
 
-static uint32_t index_of_msbit_in_word(uint32_t word)
+static uint32_t index_of_msbit_in_word(limb_t word)
 {
-	if (word) {
-		uint32_t byte = 1;
-		while ((uint64_t)word >> (byte << 3)) {
-			byte ++;
-		}
-		int bit = (byte - 1) << 3;
-		while ((uint64_t)word >> bit) {
-			bit ++;
-		}
-		return bit - 1;
-	} else {
-		return 0;
+	uint32_t bit = 0;
+	while (word >> 8) {
+		word >>= 8;
+		bit += 8;
 	}
+	while (word >> 1) {
+		word >>= 1;
+		bit ++;
+	}
+	return bit;
 }
 
 uint32_t bigint_index_of_msbit(const bigint_t *big)
 {
 	if (big->len) {
 		uint32_t msbit = (big->len - 1) << BXW_2K;
-		uint32_t word = big->bits[big->len - 1];
+		limb_t word = big->bits[big->len - 1];
 		return msbit + index_of_msbit_in_word(word);
 	} else {
 		return 0;
@@ -531,7 +1204,7 @@ uint32_t bigint_get_2k_geq(const bigint_t *big)
 uint32_t bigint_truncate_u32(const bigint_t *big)
 {
 	if (big->len > 0) {
-		return big->bits[0];
+		return (uint32_t) big->bits[0];
 	} else {
 		return 0;
 	}
@@ -539,6 +1212,9 @@ uint32_t bigint_truncate_u32(const bigint_t *big)
 
 uint64_t bigint_truncate_u64(const bigint_t *big)
 {
+#ifdef BIGINT_LIMB64
+	return big->len ? big->bits[0] : 0;
+#else
 	if (big->len > 1) {
 		uint64_t n = ((uint64_t) big->bits[1]) << BITSXWORD;
 		n |= ((uint64_t) big->bits[0]);
@@ -546,109 +1222,81 @@ uint64_t bigint_truncate_u64(const bigint_t *big)
 	} else {
 		return bigint_truncate_u32(big);
 	}
+#endif
 }
 
 void bigint_add_u32(bigint_t *big, uint32_t add)
 {
-	uint64_t sum = add;
-	uint32_t len = big->len;
-	for (int i = 0; i < len; i++) {
-		sum += (uint64_t) big->bits[i];
-		big->bits[i] = (uint32_t) sum;
-		sum >>= BITSXWORD;
-		if (!sum)
-			break;
-	}
-	if (sum) {
-		if (len >= big->words)
-			bigint_duplicate_words(big, len);
-		big->bits[len] = sum;
-		len ++;
+	add_limb(big, add);
+}
+
+static void add_limb(bigint_t *big, limb_t add)
+{
+	limb_t carry = words_add_1(big->bits, big->bits, big->len, add);
+	if (carry) {
+		if (big->len >= big->words)
+			bigint_duplicate_words(big, big->len + 1);
+		big->bits[big->len] = carry;
+		big->len ++;
 	}
-	big->len = len;
 }
 
 void bigint_add_u64(bigint_t *big, uint64_t add)
 {
-	uint64_t sum = (uint32_t) add;
-	uint32_t sum_aux = (uint32_t) (add >> BITSXWORD);
-	uint32_t len = big->len;
-	for (int i = 0; i < len; i++) {
-		sum += (uint64_t) big->bits[i];
-		if (i == 1)
-			sum += sum_aux;
-		big->bits[i] = (uint32_t) sum;
-		sum >>= BITSXWORD;
-		if (!sum)
-			break;
-	}
-	if (sum) {
-		if (len >= big->words)
-			bigint_duplicate_words(big, len);
-		big->bits[len] = sum;
-		len ++;
-	}
-	big->len = len;
+#ifdef BIGINT_LIMB64
+	add_limb(big, add);
+#else
+	limb_t w[2] = {(limb_t) add, (limb_t) (add >> BITSXWORD)};
+	bigint_t aux = {2, w[1] ? 2 : (w[0] ? 1 : 0), w, NULL, {0}};
+	bigint_add(big, &aux);
+#endif
 }
 
 void bigint_add_2k(bigint_t *big, uint32_t bit)
 {
 	uint32_t word = bit >> BXW_2K;
 	bit -= (word << BXW_2K);
-	uint64_t sum = 1;
-	sum <<= bit;
 	
 	uint32_t len = MAX(big->len, word + 1);
 	if (len > big->words)
 		bigint_duplicate_words(big, len);
+	if (len > big->len)
+		memset(big->bits + big->len, 0,
+		       (len - big->len) * sizeof(limb_t));
 	
-	for (int i = word; i < len; i++) {
-		if (i < big->len)
-			sum += (uint64_t) big->bits[i];
-		big->bits[i] = (uint32_t) sum;
-		sum >>= BITSXWORD;
-	}
-	if (sum) {
+	limb_t carry = words_add_1(big->bits + word, big->bits + word,
+				   len - word, (limb_t) 1 << bit);
+	if (carry) {
 		if (len >= big->words)
 			bigint_duplicate_words(big, len + 1);
-		big->bits[len] = sum;
+		big->bits[len] = carry;
 		len ++;
 	}
 	big->len = len;
 }
 
-static void add_from_word(bigint_t *big, const bigint_t *add, uint32_t w)
+void bigint_add(bigint_t *big, const bigint_t *add)
 {
 	uint32_t len = MAX(big->len, add->len);
 	if (len > big->words)
 		bigint_duplicate_words(big, len);
 
-	uint64_t sum = 0;
-	for (int i = w; i < len; i++) {
-		if (i < add->len) {
-			sum += (uint64_t) big->bits[i] + add->bits[i];
-		} else {
-			if (!sum)
-				break;
-			sum += (uint64_t) big->bits[i];
-		}
-		big->bits[i] = (uint32_t) sum;
-		sum >>= BITSXWORD;
-	}
-	if (sum) {
+	limb_t carry;
+	if (big->len >= add->len)
+		carry = words_add(big->bits, big->bits, big->len,
+				  add->bits, add->len);
+	else
+		carry = words_add(big->bits, add->bits, add->len,
+				  big->bits, big->len);
+	if (carry) {
 		if (len >= big->words)
 			bigint_duplicate_words(big, len + 1);
-		big->bits[len] = sum;
+		big->bits[len] = carry;
 		len ++;
 	}
 	big->len = len;
 }
 
-void bigint_add(bigint_t *big, const bigint_t *add)
-{
-	add_from_word(big, add, 0);
-}
-
 void bigint_increment(bigint_t *big)
 {
 	bigint_add_u32(big, 1);
@@ -658,17 +1306,7 @@ void bigint_subtract_u32(bigint_t *big, uint32_t num, int *status)
 {
 	reset_flag_nullsafe(status);
 	
-	uint64_t borrow = (uint64_t) big->bits[0] - num;
-	big->bits[0] = (uint32_t) borrow;
-	borrow = (borrow >> BITSXWORD) & 1;
-	uint32_t i;
-	for (i = 1; i < big->len; i++) {
-		borrow = (uint64_t) big->bits[i] - borrow;
-		big->bits[i] = (uint32_t) borrow;
-		borrow = (borrow >> BITSXWORD) & 1;
-		if (!borrow)
-			break;
-	}
+	limb_t borrow = words_sub_1(big->bits, big->bits, big->len, num);
 	bigint_update_len(big);
 	
 	if (borrow) {
@@ -684,16 +1322,10 @@ void bigint_subtract_2k(bigint_t *big, uint32_t bit, int *status)
 	
 	uint32_t word = bit >> BXW_2K;
 	bit -= (word << BXW_2K);	
-	uint64_t borrow = 1;
-	borrow <<= bit;
-	
-	for (int i = word; i < big->len; i++) {
-		borrow = (uint64_t) big->bits[i] - borrow;
-		big->bits[i] = (uint32_t) borrow;
-		borrow = (borrow >> BITSXWORD) & 1;
-		if (!borrow)
-			break;
-	}
+	limb_t borrow = 1;
+	if (word < big->len)
+		borrow = words_sub_1(big->bits + word, big->bits + word,
+				     big->len - word, (limb_t) 1 << bit);
 	bigint_update_len(big);
 	
 	if (borrow) {
@@ -706,21 +1338,13 @@ void bigint_subtract(bigint_t *big, const bigint_t *num, int *status)
 {
 	reset_flag_nullsafe(status);
 	
-	uint64_t borrow = 0;
-	for (int i = 0; i < big->len; i++) {
-		if (i < num->len) {
-			borrow = (uint64_t) big->bits[i] - num->bits[i] - borrow;
-		} else {
-			if (!borrow)
-				break;
-			borrow = (uint64_t) big->bits[i] - borrow;
-		}
-		big->bits[i] = (uint32_t) borrow;
-		borrow = (borrow >> BITSXWORD) & 1; 
-	}
+	/* Words of num beyond the length of big are a borrow anyway */
+	uint32_t len = big->len;
+	limb_t borrow = words_sub(big->bits, big->bits, len, num->bits,
+				  MIN(len, num->len));
 	bigint_update_len(big);
 
-	if (borrow) {
+	if (borrow || num->len > len) {
 		/* num is greater than big */
 		set_flag_nullsafe(status, STATUS_ERROR_BAD_INPUT);
 	}
@@ -737,7 +1361,7 @@ void bigint_decrement(bigint_t *big)
 			i++;
 		}
 		big->bits[i] -= 1;
-		if (!big->bits[i])
+		if (!big->bits[i] && i == big->len - 1)
 			big->len -= 1;
 	}
 }
@@ -745,13 +1369,12 @@ void bigint_decrement(bigint_t *big)
 static void bigint_shift_left_bits(bigint_t *big, uint32_t n)
 {
 	if (n > 0 && big->len > 0) {
-		uint32_t len = big->len;    
-		for (uint32_t i = len; i > 0; i--) {
-			big->bits[i] |= big->bits[i - 1] >> (BITSXWORD - n);
-			big->bits[i - 1] <<= n;
-		}
-		if (big->bits[len])
+		uint32_t len = big->len;
+		limb_t out = words_lshift(big->bits, big->bits, len, n);
+		if (out) {
+			big->bits[len] = out;
 			big->len = len + 1;
+		}
 	}
 }
 
@@ -759,17 +1382,17 @@ static void bigint_shift_left_words(bigint_t *big, uint32_t n)
 {
 	if (n > 0 && big->len > 0) {
 		if (big->len > 100) {
-			uint32_t *aux = malloc(big->len * sizeof(uint32_t));
-			memcpy(aux, big->bits, big->len * sizeof(uint32_t));
-			memset(big->bits, 0, n * sizeof(uint32_t));
-			memcpy(big->bits + n, aux, big->len * sizeof(uint32_t));
+			limb_t *aux = malloc(big->len * sizeof(limb_t));
+			memcpy(aux, big->bits, big->len * sizeof(limb_t));
+			memset(big->bits, 0, n * sizeof(limb_t));
+			memcpy(big->bits + n, aux, big->len * sizeof(limb_t));
 			big->len += n;
 			free(aux);
 		} else {
-			uint32_t aux[100];
-			memcpy(aux, big->bits, big->len * sizeof(uint32_t));
-			memset(big->bits, 0, n * sizeof(uint32_t));
-			memcpy(big->bits + n, aux, big->len * sizeof(uint32_t));
+			limb_t aux[100];
+			memcpy(aux, big->bits, big->len * sizeof(limb_t));
+			memset(big->bits, 0, n * sizeof(limb_t));
+			memcpy(big->bits + n, aux, big->len * sizeof(limb_t));
 			big->len += n;
 		}
 	}
@@ -810,22 +1433,19 @@ static void bigint_shift_right_words(bigint_t *big, uint32_t n)
 		if (n < big->len) {
 			uint32_t aux_len = (big->len - n);
 			if (aux_len > 100) {
-				uint32_t *aux = malloc(aux_len * sizeof(uint32_t));
-				memcpy(aux, big->bits + n, aux_len * sizeof(uint32_t));
-				memcpy(big->bits, aux, aux_len * sizeof(uint32_t));
-				memset(big->bits + aux_len, 0, n * sizeof(uint32_t));
+				limb_t *aux = malloc(aux_len * sizeof(limb_t));
+				memcpy(aux, big->bits + n, aux_len * sizeof(limb_t));
+				memcpy(big->bits, aux, aux_len * sizeof(limb_t));
 				big->len -= n;
 				free(aux);
 			} else {
-				uint32_t aux[100];
-				memcpy(aux, big->bits + n, aux_len * sizeof(uint32_t));
-				memcpy(big->bits, aux, aux_len * sizeof(uint32_t));
-				memset(big->bits + aux_len, 0, n * sizeof(uint32_t));
+				limb_t aux[100];
+				memcpy(aux, big->bits + n, aux_len * sizeof(limb_t));
+				memcpy(big->bits, aux, aux_len * sizeof(limb_t));
 				big->len -= n;
 			}
 		} else {
 			big->len = 0;
-			memset(big->bits, 0, big->len * sizeof(uint32_t));
 		}
 	}
 }
@@ -846,7 +1466,8 @@ void bigint_mul_u32(const bigint_t *big, uint32_t x, bigint_t *result)
 	if (result->words < big->len + 1)
 		bigint_duplicate_words(result, big->len + 1);
 
-	bigint_set_u32(result, 0);
+	/* add_mul_word adds to the words of result */
+	memset(result->bits, 0, (big->len + 1) * sizeof(limb_t));
 	add_mul_word(big, x, result, 0);
 }
 
@@ -860,30 +1481,25 @@ void bigint_mul_u64(const bigint_t *big, uint64_t x, bigint_t *result)
 	if (result->words < big->len + 2)
 		bigint_duplicate_words(result, big->len + 2);
 
-	bigint_set_u32(result, 0);
+	memset(result->bits, 0, (big->len + 2) * sizeof(limb_t));
+#ifdef BIGINT_LIMB64
+	add_mul_word(big, x, result, 0);
+#else
 	add_mul_word(big, (uint32_t) x, result, 0);
 	add_mul_word(big, (uint32_t) (x >> BITSXWORD), result, 1);
+#endif
 }
 
-static void add_mul_word(const bigint_t *big, uint32_t word,
+static void add_mul_word(const bigint_t *big, limb_t word,
 			 bigint_t *result, uint32_t i)
 {
 	if (!word)
 		return;
 	
-	uint64_t mul_carry = 0;
-	uint64_t sum_carry = 0;
-	uint32_t j;
-	for (j = 0; j < big->len; j++) {
-		mul_carry += (uint64_t) big->bits[j] * word;
-		sum_carry += (uint64_t) result->bits[i + j] +
-			(uint32_t) mul_carry;
-		mul_carry >>= BITSXWORD;
-		result->bits[i + j] = (uint32_t) sum_carry;
-		sum_carry >>= BITSXWORD;
-	}
-	if (mul_carry || sum_carry) {
-		result->bits[i + j] += sum_carry + mul_carry;
+	uint32_t j = big->len;
+	limb_t carry = words_addmul_1(result->bits + i, big->bits, j, word);
+	if (carry) {
+		result->bits[i + j] += carry;
 		result->len =  i + j + 1;
 	} else {
 		result->len = i + j;
@@ -897,6 +1513,10 @@ void bigint_mul_2k(bigint_t *big, uint32_t k)
 
 void bigint_mul(const bigint_t *big, const bigint_t *x, bigint_t *result)
 {
+	if (big == x) {
+		bigint_sqr(big, result);
+		return;
+	}
 	if (bigint_is_zero(big) || bigint_is_zero(x)) {
 		bigint_set_u32(result, 0);
 		return;
@@ -906,645 +1526,4294 @@ void bigint_mul(const bigint_t *big, const bigint_t *x, bigint_t *result)
 		bigint_duplicate_words(result, big->len + x->len);
 
 	bigint_set_u32(result, 0);
-	uint32_t i;
-	for (i = 0; i < x->len; i ++) {
-		add_mul_word(big, x->bits[i], result, i);
-	}
+	limb_t *tmp = NULL;
+	size_t ntmp = mul_scratch_words(big->len, x->len);
+	if (ntmp)
+		tmp = malloc(ntmp * sizeof(limb_t));
+	words_mul_top(result->bits, big->bits, big->len, x->bits, x->len, tmp);
+	free(tmp);
+	result->len = big->len + x->len;
+	bigint_update_len(result);
 }
 
-void bigint_div_u32(bigint_t *big, uint32_t div, uint32_t *res)
+void bigint_set_karatsuba_threshold(uint32_t words)
 {
-	if (!div) {
-		/* PENDING: Set infty */
-		bigint_set_max(big);
-		*res = 0;
-	} else {
-		*res = 0;
-		int32_t lmword = big->len - 1;
-		for (int64_t i = lmword; i >= 0; i--) {
-			uint64_t aux = (uint64_t)(*res) << BITSXWORD;
-			*res = (aux + big->bits[i]) % div;
-			big->bits[i] = (aux + big->bits[i]) / div;
-		}
-		bigint_update_len(big);
-	}
+	/* words counts 32 bits words, as bigint_create, and the minimums
+	 * below are in limbs. Karatsuba halves need at least 4 limbs to
+	 * get smaller.
+	 */
+	karatsuba_threshold = MAX(THRESHOLD_LIMBS(words), 4);
 }
 
-void bigint_div_u64(bigint_t *big, uint64_t div, uint64_t *res)
+void bigint_set_sqr_karatsuba_threshold(uint32_t words)
 {
-	if (!div) {
-		/* PENDING: Set infty */
-		bigint_set_max(big);
-		*res = 0;
-	} else {
-		int cmp = bigint_compare_u64(big, div);
-		if (cmp == 0) {
-			bigint_set_u32(big, 1);
-			*res = 0;
-		} else if (cmp < 0) {
-			*res = bigint_truncate_u64(big);
-			bigint_set_u32(big, 0);
-		} else {
-			if (big->len < 2) {
-				uint64_t N = (uint64_t) big->bits[1];
-				N <<= BITSXWORD;
-				N |= (uint64_t) big->bits[0];
-				*res = N % div;
-				bigint_set_u64(big, N / div);
-			} else {
-				*res = 0;
-				int lmword = big->len;
-				for (int b = BITSXWORD - 1; b >= 0; b--) {
-					uint32_t i = (lmword << BXW_2K) + b;
-					uint32_t mask = (1 << b);
-					(*res) <<= 1;
-					if (big->bits[lmword] & mask)
-						(*res) |= 1;
-		    
-					if (*res >= div) {
-						(*res) -= div;
-						big->bits[lmword] |= mask; 
-					} else {
-						big->bits[lmword] &= ~mask; 
-					}
-				}
-				for (int w = lmword - 1; w >= 0; w--) {
-					if (big->bits[w] || *res) {
-						for (int b = BITSXWORD - 1; b >= 0; b--) {
-							uint32_t i = (w << BXW_2K) + b;
-							uint32_t mask = (1 << b);
-							(*res) <<= 1;
-							if (big->bits[w] & mask)
-								(*res) |= 1;
-		    
-							if (*res >= div) {
-								(*res) -= div;
-								big->bits[w] |= mask; 
-							} else {
-								big->bits[w] &= ~mask; 
-							}
-						}
-					}
-				}
-				bigint_update_len(big);
-			}
-		}
-	}
+	sqr_karatsuba_threshold = MAX(THRESHOLD_LIMBS(words), 4);
 }
 
-void bigint_div_2k(bigint_t *big, uint32_t k)
+void bigint_set_toom3_threshold(uint32_t words)
 {
-	bigint_shift_right(big, k);
+	/* Toom-3 needs three non empty pieces and smaller products */
+	toom3_threshold = MAX(THRESHOLD_LIMBS(words), 16);
 }
 
-void bigint_div(bigint_t *big, const bigint_t *div, bigint_t *res)
+void bigint_set_toom4_threshold(uint32_t words)
 {
-	if (bigint_is_zero(div)) {
-		/* PENDING: Set infty */
-		bigint_set_max(big);
-		bigint_set_u32(res, 0);
-	} else {
-		int cmp = bigint_compare(big, div);
-		if (cmp == 0) {
-			bigint_set_u32(big, 1);
-			bigint_set_u32(res, 0);
-		} else if (cmp < 0) {
-			bigint_copy(res, big);
-			bigint_set_u32(big, 0);
-		} else {
-			if (big->len < 2) {
-				bigint_set_u32(res, big->bits[0] % div->bits[0]);
-				bigint_set_u32(big, big->bits[0] / div->bits[0]);
+	toom4_threshold = MAX(THRESHOLD_LIMBS(words), 32);
+}
+
+void bigint_set_ntt_threshold(uint32_t words)
+{
+	ntt_threshold = MAX(THRESHOLD_LIMBS(words), 1);
+}
+
+uint32_t bigint_get_karatsuba_threshold(void)
+{
+	/* In 32 bits words, as the setters */
+	return karatsuba_threshold * (BITSXWORD / 32);
+}
+
+uint32_t bigint_get_sqr_karatsuba_threshold(void)
+{
+	return sqr_karatsuba_threshold * (BITSXWORD / 32);
+}
+
+uint32_t bigint_get_toom3_threshold(void)
+{
+	return toom3_threshold * (BITSXWORD / 32);
+}
+
+uint32_t bigint_get_toom4_threshold(void)
+{
+	return toom4_threshold * (BITSXWORD / 32);
+}
+
+uint32_t bigint_get_ntt_threshold(void)
+{
+	return ntt_threshold * (BITSXWORD / 32);
+}
+
+void bigint_set_decimal_threshold(uint32_t words)
+{
+	decimal_threshold = THRESHOLD_LIMBS(words);
+}
+
+void bigint_set_hgcd_threshold(uint32_t words)
+{
+	/* The recursion needs top halves well over two limbs */
+	hgcd_threshold = MAX(THRESHOLD_LIMBS(words), 8);
+}
+
+void bigint_set_parallel_threshold(uint32_t words)
+{
+	parallel_threshold = MAX(THRESHOLD_LIMBS(words), 1);
+}
+
+uint32_t bigint_get_decimal_threshold(void)
+{
+	return decimal_threshold * (BITSXWORD / 32);
+}
+
+uint32_t bigint_get_parallel_threshold(void)
+{
+	return parallel_threshold * (BITSXWORD / 32);
+}
+
+void bigint_set_num_threads(uint32_t threads)
+{
+	/* 1 keeps every product in the calling thread, 0 takes as many
+	 * threads as OpenMP offers. Without OpenMP it has no effect.
+	 */
+#ifdef _OPENMP
+	if (threads == 0)
+		threads = omp_get_max_threads();
+#endif
+	num_threads = MAX(threads, 1);
+}
+
+uint32_t bigint_get_num_threads(void)
+{
+#ifdef _OPENMP
+	return num_threads;
+#else
+	return 1;
+#endif
+}
+
+static limb_t words_add_n_c(limb_t *r, const limb_t *a, const limb_t *b,
+			    uint32_t n, limb_t carry)
+{
+	/* r[0..n) <- a + b + carry, returns the carry out */
+	for (uint32_t i = 0; i < n; i++) {
+		limb_t s = a[i] + carry;
+		carry = (s < carry);
+		r[i] = s + b[i];
+		carry += (r[i] < s);
+	}
+	return carry;
+}
+
+static limb_t words_sub_n_c(limb_t *r, const limb_t *a, const limb_t *b,
+			    uint32_t n, limb_t borrow)
+{
+	/* r[0..n) <- a - b - borrow, returns the borrow out */
+	for (uint32_t i = 0; i < n; i++) {
+		limb_t d = a[i] - borrow;
+		borrow = (d > a[i]);
+		r[i] = d - b[i];
+		borrow += (r[i] > d);
+	}
+	return borrow;
+}
+
+#ifdef BIGINT_X86_64_KERNELS
+static uint64_t add_n_adc(uint64_t *r, const uint64_t *a, const uint64_t *b,
+			  size_t n4, uint64_t carry)
+{
+	/* r[0..4 n4) <- a + b + carry with one ADC chain, DEC and LEA
+	 * leave CF alone.
+	 */
+	__asm__ volatile (
+		"neg %[c]\n\t"
+		"1:\n\t"
+		"mov (%[a]), %%r8\n\t"
+		"adc (%[b]), %%r8\n\t"
+		"mov %%r8, (%[r])\n\t"
+		"mov 8(%[a]), %%r9\n\t"
+		"adc 8(%[b]), %%r9\n\t"
+		"mov %%r9, 8(%[r])\n\t"
+		"mov 16(%[a]), %%r8\n\t"
+		"adc 16(%[b]), %%r8\n\t"
+		"mov %%r8, 16(%[r])\n\t"
+		"mov 24(%[a]), %%r9\n\t"
+		"adc 24(%[b]), %%r9\n\t"
+		"mov %%r9, 24(%[r])\n\t"
+		"lea 32(%[a]), %[a]\n\t"
+		"lea 32(%[b]), %[b]\n\t"
+		"lea 32(%[r]), %[r]\n\t"
+		"dec %[n]\n\t"
+		"jnz 1b\n\t"
+		"mov $0, %k[c]\n\t"
+		"setc %b[c]\n\t"
+		: [r] "+r" (r), [a] "+r" (a), [b] "+r" (b), [n] "+r" (n4),
+		  [c] "+r" (carry)
+		:
+		: "r8", "r9", "cc", "memory");
+	return carry;
+}
+
+static uint64_t sub_n_sbb(uint64_t *r, const uint64_t *a, const uint64_t *b,
+			  size_t n4, uint64_t borrow)
+{
+	/* Same as add_n_adc with SBB */
+	__asm__ volatile (
+		"neg %[c]\n\t"
+		"1:\n\t"
+		"mov (%[a]), %%r8\n\t"
+		"sbb (%[b]), %%r8\n\t"
+		"mov %%r8, (%[r])\n\t"
+		"mov 8(%[a]), %%r9\n\t"
+		"sbb 8(%[b]), %%r9\n\t"
+		"mov %%r9, 8(%[r])\n\t"
+		"mov 16(%[a]), %%r8\n\t"
+		"sbb 16(%[b]), %%r8\n\t"
+		"mov %%r8, 16(%[r])\n\t"
+		"mov 24(%[a]), %%r9\n\t"
+		"sbb 24(%[b]), %%r9\n\t"
+		"mov %%r9, 24(%[r])\n\t"
+		"lea 32(%[a]), %[a]\n\t"
+		"lea 32(%[b]), %[b]\n\t"
+		"lea 32(%[r]), %[r]\n\t"
+		"dec %[n]\n\t"
+		"jnz 1b\n\t"
+		"mov $0, %k[c]\n\t"
+		"setc %b[c]\n\t"
+		: [r] "+r" (r), [a] "+r" (a), [b] "+r" (b), [n] "+r" (n4),
+		  [c] "+r" (borrow)
+		:
+		: "r8", "r9", "cc", "memory");
+	return borrow;
+}
+#endif
+
+static limb_t words_add_n(limb_t *r, const limb_t *a, const limb_t *b,
+			  uint32_t n)
+{
+	/* r[0..n) <- a + b, returns the carry. r may be a or b. On x86-64
+	 * the low words left over by blocks of four 64 bits words take
+	 * the C loop and the rest one ADC chain.
+	 */
+#ifdef BIGINT_X86_64_KERNELS
+	uint32_t per = 64 / BITSXWORD;
+	uint32_t k = n % (4 * per);
+	limb_t carry = words_add_n_c(r, a, b, k, 0);
+	if (k == n)
+		return carry;
+	return (limb_t) add_n_adc((uint64_t *) (r + k),
+				  (const uint64_t *) (a + k),
+				  (const uint64_t *) (b + k),
+				  (n - k) / (4 * per), carry);
+#else
+	return words_add_n_c(r, a, b, n, 0);
+#endif
+}
+
+static limb_t words_sub_n(limb_t *r, const limb_t *a, const limb_t *b,
+			  uint32_t n)
+{
+	/* r[0..n) <- a - b, returns the borrow. r may be a or b */
+#ifdef BIGINT_X86_64_KERNELS
+	uint32_t per = 64 / BITSXWORD;
+	uint32_t k = n % (4 * per);
+	limb_t borrow = words_sub_n_c(r, a, b, k, 0);
+	if (k == n)
+		return borrow;
+	return (limb_t) sub_n_sbb((uint64_t *) (r + k),
+				  (const uint64_t *) (a + k),
+				  (const uint64_t *) (b + k),
+				  (n - k) / (4 * per), borrow);
+#else
+	return words_sub_n_c(r, a, b, n, 0);
+#endif
+}
+
+static limb_t words_add_1(limb_t *r, const limb_t *a, uint32_t n, limb_t c)
+{
+	/* r[0..n) <- a + c, returns the carry. In place it stops with
+	 * the carry, otherwise the rest of a is copied.
+	 */
+	uint32_t i = 0;
+	for (; i < n && c; i++) {
+		r[i] = a[i] + c;
+		c = (r[i] < c);
+	}
+	if (r != a && i < n)
+		memcpy(r + i, a + i, (n - i) * sizeof(limb_t));
+	return c;
+}
+
+static limb_t words_sub_1(limb_t *r, const limb_t *a, uint32_t n, limb_t c)
+{
+	/* r[0..n) <- a - c, returns the borrow. Same as words_add_1 */
+	uint32_t i = 0;
+	for (; i < n && c; i++) {
+		limb_t d = a[i] - c;
+		c = (d > a[i]);
+		r[i] = d;
+	}
+	if (r != a && i < n)
+		memcpy(r + i, a + i, (n - i) * sizeof(limb_t));
+	return c;
+}
+
+static limb_t words_add(limb_t *r, const limb_t *a, uint32_t na,
+			const limb_t *b, uint32_t nb)
+{
+	/* r <- a + b, requires na >= nb. Returns the carry out of r[na-1],
+	 * r may be the same array as a.
+	 */
+	limb_t carry = words_add_n(r, a, b, nb);
+	return words_add_1(r + nb, a + nb, na - nb, carry);
+}
+
+static int words_cmp(const limb_t *a, const limb_t *b, uint32_t n)
+{
+	for (uint32_t i = n; i-- > 0;) {
+		if (a[i] != b[i])
+			return (a[i] > b[i]) ? 1 : -1;
+	}
+	return 0;
+}
+
+static limb_t words_sub(limb_t *r, const limb_t *a, uint32_t na,
+			const limb_t *b, uint32_t nb)
+{
+	/* r <- a - b, requires na >= nb. Returns the borrow,
+	 * r may be the same array as a.
+	 */
+	limb_t borrow = words_sub_n(r, a, b, nb);
+	return words_sub_1(r + nb, a + nb, na - nb, borrow);
+}
+
+static limb_t words_addlsh_n(limb_t *r, const limb_t *a, const limb_t *b,
+			     uint32_t n, uint32_t s)
+{
+	/* r[0..n) <- a + b * 2^s, 0 < s < BITSXWORD. Returns the carry
+	 * plus the bits of b shifted out. r may be a.
+	 */
+	limb_t carry = 0;
+	limb_t prev = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		limb_t sh = (b[i] << s) | prev;
+		prev = b[i] >> (BITSXWORD - s);
+		limb_t t = a[i] + carry;
+		carry = (t < carry);
+		r[i] = t + sh;
+		carry += (r[i] < t);
+	}
+	return prev + carry;
+}
+
+static limb_t words_sublsh_n(limb_t *r, const limb_t *a, const limb_t *b,
+			     uint32_t n, uint32_t s)
+{
+	/* r[0..n) <- a - b * 2^s, 0 < s < BITSXWORD. Returns the borrow
+	 * plus the bits of b shifted out. r may be a.
+	 */
+	limb_t borrow = 0;
+	limb_t prev = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		limb_t sh = (b[i] << s) | prev;
+		prev = b[i] >> (BITSXWORD - s);
+		limb_t d = a[i] - borrow;
+		borrow = (d > a[i]);
+		r[i] = d - sh;
+		borrow += (r[i] > d);
+	}
+	return prev + borrow;
+}
+
+static limb_t words_addmul_1_c(limb_t *r, const limb_t *a, uint32_t n,
+			       limb_t word)
+{
+	/* r[0..n) <- r[0..n) + a * word, returns the carry word */
+	dlimb_t mul_carry = 0;
+	dlimb_t sum_carry = 0;
+	for (uint32_t j = 0; j < n; j++) {
+		mul_carry += (dlimb_t) a[j] * word;
+		sum_carry += (dlimb_t) r[j] + (limb_t) mul_carry;
+		mul_carry >>= BITSXWORD;
+		r[j] = (limb_t) sum_carry;
+		sum_carry >>= BITSXWORD;
+	}
+	return (limb_t) (sum_carry + mul_carry);
+}
+
+static limb_t words_submul_1(limb_t *r, const limb_t *a, uint32_t n,
+			     limb_t word)
+{
+	/* r[0..n) <- r[0..n) - a * word, returns the borrow word */
+	dlimb_t mul_carry = 0;
+	limb_t borrow = 0;
+	for (uint32_t j = 0; j < n; j++) {
+		mul_carry += (dlimb_t) a[j] * word;
+		limb_t sub = (limb_t) mul_carry;
+		mul_carry >>= BITSXWORD;
+		dlimb_t diff = (dlimb_t) r[j] - sub - borrow;
+		r[j] = (limb_t) diff;
+		borrow = (limb_t) (diff >> BITSXWORD) & 1;
+	}
+	return (limb_t) mul_carry + borrow;
+}
+
+#ifdef BIGINT_X86_64_KERNELS
+__attribute__((target("bmi2,adx")))
+static uint64_t addmul_1_adx(uint64_t *r, const uint64_t *a, size_t n4,
+			     uint64_t word, uint64_t carry)
+{
+	/* r[0..4 n4) <- r + a * word + carry on 64 bits words. The high
+	 * halves of MULX ride the CF chain of ADCX and the words of r the
+	 * OF chain of ADOX, LEA and JRCXZ leave both flags alone.
+	 */
+	uint64_t lo, hi;
+	__asm__ volatile (
+		"xor %%r8d, %%r8d\n\t"
+		"1:\n\t"
+		"mulx (%[a]), %[lo], %[hi]\n\t"
+		"adcx %[c], %[lo]\n\t"
+		"adox (%[r]), %[lo]\n\t"
+		"mov %[lo], (%[r])\n\t"
+		"mulx 8(%[a]), %[lo], %[c]\n\t"
+		"adcx %[hi], %[lo]\n\t"
+		"adox 8(%[r]), %[lo]\n\t"
+		"mov %[lo], 8(%[r])\n\t"
+		"mulx 16(%[a]), %[lo], %[hi]\n\t"
+		"adcx %[c], %[lo]\n\t"
+		"adox 16(%[r]), %[lo]\n\t"
+		"mov %[lo], 16(%[r])\n\t"
+		"mulx 24(%[a]), %[lo], %[c]\n\t"
+		"adcx %[hi], %[lo]\n\t"
+		"adox 24(%[r]), %[lo]\n\t"
+		"mov %[lo], 24(%[r])\n\t"
+		"lea 32(%[a]), %[a]\n\t"
+		"lea 32(%[r]), %[r]\n\t"
+		"lea -1(%[n]), %[n]\n\t"
+		"jrcxz 2f\n\t"
+		"jmp 1b\n\t"
+		"2:\n\t"
+		"adcx %%r8, %[c]\n\t"
+		"adox %%r8, %[c]\n\t"
+		: [r] "+r" (r), [a] "+r" (a), [n] "+c" (n4), [c] "+r" (carry),
+		  [lo] "=&r" (lo), [hi] "=&r" (hi)
+		: "d" (word)
+		: "r8", "cc", "memory");
+	return carry;
+}
+
+static limb_t words_addmul_1_adx(limb_t *r, const limb_t *a, uint32_t n,
+				 limb_t word)
+{
+	/* Same as words_addmul_1_c. The low words left over by blocks of
+	 * four 64 bits words take the C loop, with 32 bits limbs pairs of
+	 * them are read as one 64 bits word and the carry fits a limb.
+	 */
+	uint32_t per = 64 / BITSXWORD;
+	uint32_t k = n % (4 * per);
+	limb_t carry = words_addmul_1_c(r, a, k, word);
+	if (k == n)
+		return carry;
+	return (limb_t) addmul_1_adx((uint64_t *) (r + k),
+				     (const uint64_t *) (a + k),
+				     (n - k) / (4 * per), word, carry);
+}
+
+static uint32_t ifma_split(uint64_t *x, const limb_t *a, uint32_t n)
+{
+	/* x <- a[0..n) in digits of 52 bits, returns their number */
+	unsigned __int128 acc = 0;
+	uint32_t bits = 0;
+	uint32_t nd = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		acc |= (unsigned __int128) a[i] << bits;
+		bits += BITSXWORD;
+		while (bits >= 52) {
+			x[nd++] = (uint64_t) acc & IFMA_MASK;
+			acc >>= 52;
+			bits -= 52;
+		}
+	}
+	if (bits)
+		x[nd++] = (uint64_t) acc;
+	return nd;
+}
+
+__attribute__((target("avx512f,avx512ifma")))
+static void words_mul_ifma(limb_t *r, const limb_t *a, uint32_t na,
+			   const limb_t *b, uint32_t nb)
+{
+	/* Product scanning in radix 2^52, eight columns per vector. The
+	 * low and high halves of the digit products are summed apart,
+	 * each column below 2^64 while the factors have at most
+	 * IFMA_MAX_DIGITS digits, and the carries are propagated once.
+	 */
+	uint64_t xpad[IFMA_MAX_DIGITS + 16];
+	uint64_t y[IFMA_MAX_DIGITS];
+	uint64_t lo[2 * IFMA_MAX_DIGITS + 8];
+	uint64_t hi[2 * IFMA_MAX_DIGITS + 8];
+	uint64_t *x = xpad + 8;
+	memset(xpad, 0, 8 * sizeof(uint64_t));
+	int64_t da = ifma_split(x, a, na);
+	int64_t db = ifma_split(y, b, nb);
+	memset(x + da, 0, 8 * sizeof(uint64_t));
+
+	uint32_t nc = (uint32_t) (da + db);
+	for (int64_t c = 0; c < nc; c += 8) {
+		__m512i vlo = _mm512_setzero_si512();
+		__m512i vhi = _mm512_setzero_si512();
+		int64_t jhi = MIN(c + 7, db - 1);
+		for (int64_t j = MAX(c - da + 1, 0); j <= jhi; j++) {
+			__m512i va = _mm512_loadu_si512(x + c - j);
+			__m512i vb = _mm512_set1_epi64((long long) y[j]);
+			vlo = _mm512_madd52lo_epu64(vlo, va, vb);
+			vhi = _mm512_madd52hi_epu64(vhi, va, vb);
+		}
+		_mm512_storeu_si512(lo + c, vlo);
+		_mm512_storeu_si512(hi + c, vhi);
+	}
+
+	unsigned __int128 acc = 0;
+	uint32_t bits = 0;
+	uint32_t k = 0;
+	uint64_t carry = 0;
+	for (uint32_t c = 0; c < nc; c++) {
+		uint64_t t = lo[c] + carry + (c ? hi[c - 1] : 0);
+		carry = t >> 52;
+		acc |= (unsigned __int128) (t & IFMA_MASK) << bits;
+		bits += 52;
+		while (bits >= BITSXWORD && k < na + nb) {
+			r[k++] = (limb_t) acc;
+			acc >>= BITSXWORD;
+			bits -= BITSXWORD;
+		}
+	}
+	while (k < na + nb) {
+		r[k++] = (limb_t) acc;
+		acc >>= BITSXWORD;
+	}
+}
+
+static int ifma_applies(uint32_t na, uint32_t nb, uint32_t threshold)
+{
+	return mul_kernel == BIGINT_KERNEL_IFMA && MIN(na, nb) >= threshold &&
+		MAX(na, nb) <= IFMA_MAX_LIMBS;
+}
+
+static int cpu_kernel(void)
+{
+	/* Best kernel of this processor, AVX-512 also needs the operating
+	 * system to save the zmm registers.
+	 */
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return BIGINT_KERNEL_C;
+	int adx = ((ebx >> 8) & 1) && ((ebx >> 19) & 1);
+	int ifma = ((ebx >> 16) & 1) && ((ebx >> 21) & 1);
+	if (ifma) {
+		__get_cpuid(1, &eax, &ebx, &ecx, &edx);
+		uint32_t xcr0 = 0;
+		if ((ecx >> 27) & 1)
+			__asm__ ("xgetbv" : "=a" (xcr0) : "c" (0) : "edx");
+		ifma = ((xcr0 & 0xE6) == 0xE6);
+	}
+	if (adx && ifma)
+		return BIGINT_KERNEL_IFMA;
+	else if (adx)
+		return BIGINT_KERNEL_ADX;
+	else
+		return BIGINT_KERNEL_C;
+}
+
+static int cpu_avx2(void)
+{
+	/* AVX2 and the ymm registers saved by the operating system */
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) ||
+	    !((ebx >> 5) & 1))
+		return 0;
+	__get_cpuid(1, &eax, &ebx, &ecx, &edx);
+	uint32_t xcr0 = 0;
+	if ((ecx >> 27) & 1)
+		__asm__ ("xgetbv" : "=a" (xcr0) : "c" (0) : "edx");
+	return (xcr0 & 0x6) == 0x6;
+}
+
+__attribute__((target("avx2")))
+static void lanes_addmul_avx2(uint32_t *r, const uint32_t *x,
+			      const uint32_t *y, uint32_t *c, uint32_t n)
+{
+	/* Same as lanes_addmul eight lanes at a time, n a multiple of 8.
+	 * The even lanes are multiplied in place and the odd ones shifted
+	 * down, the low words of the sums blend back into r and the high
+	 * ones into c.
+	 */
+	for (uint32_t j = 0; j < n; j += 8) {
+		__m256i vx = _mm256_loadu_si256((const __m256i *) (x + j));
+		__m256i vy = _mm256_loadu_si256((const __m256i *) (y + j));
+		__m256i vr = _mm256_loadu_si256((const __m256i *) (r + j));
+		__m256i vc = _mm256_loadu_si256((const __m256i *) (c + j));
+		__m256i lo = _mm256_set1_epi64x(0xFFFFFFFF);
+		__m256i se = _mm256_add_epi64(_mm256_mul_epu32(vx, vy),
+			_mm256_add_epi64(_mm256_and_si256(vr, lo),
+					 _mm256_and_si256(vc, lo)));
+		__m256i so = _mm256_add_epi64(_mm256_mul_epu32(
+				_mm256_srli_epi64(vx, 32), _mm256_srli_epi64(vy, 32)),
+			_mm256_add_epi64(_mm256_srli_epi64(vr, 32),
+					 _mm256_srli_epi64(vc, 32)));
+		_mm256_storeu_si256((__m256i *) (r + j), _mm256_blend_epi32(
+			se, _mm256_slli_epi64(so, 32), 0xAA));
+		_mm256_storeu_si256((__m256i *) (c + j), _mm256_blend_epi32(
+			_mm256_srli_epi64(se, 32), so, 0xAA));
+	}
+}
+
+__attribute__((target("avx2")))
+static void lanes_addmul_1_avx2(uint32_t *r, const uint32_t *x, uint32_t y,
+				uint32_t *c, uint32_t n)
+{
+	__m256i vy = _mm256_set1_epi64x(y);
+	for (uint32_t j = 0; j < n; j += 8) {
+		__m256i vx = _mm256_loadu_si256((const __m256i *) (x + j));
+		__m256i vr = _mm256_loadu_si256((const __m256i *) (r + j));
+		__m256i vc = _mm256_loadu_si256((const __m256i *) (c + j));
+		__m256i lo = _mm256_set1_epi64x(0xFFFFFFFF);
+		__m256i se = _mm256_add_epi64(_mm256_mul_epu32(vx, vy),
+			_mm256_add_epi64(_mm256_and_si256(vr, lo),
+					 _mm256_and_si256(vc, lo)));
+		__m256i so = _mm256_add_epi64(_mm256_mul_epu32(
+				_mm256_srli_epi64(vx, 32), vy),
+			_mm256_add_epi64(_mm256_srli_epi64(vr, 32),
+					 _mm256_srli_epi64(vc, 32)));
+		_mm256_storeu_si256((__m256i *) (r + j), _mm256_blend_epi32(
+			se, _mm256_slli_epi64(so, 32), 0xAA));
+		_mm256_storeu_si256((__m256i *) (c + j), _mm256_blend_epi32(
+			_mm256_srli_epi64(se, 32), so, 0xAA));
+	}
+}
+__attribute__((constructor))
+static void kernel_init(void)
+{
+	bigint_set_kernel(BIGINT_KERNEL_AUTO, NULL);
+}
+#endif
+
+static limb_t words_addmul_1(limb_t *r, const limb_t *a, uint32_t n,
+			     limb_t word)
+{
+	/* r[0..n) <- r[0..n) + a * word, returns the carry word */
+#ifdef BIGINT_X86_64_KERNELS
+	if (mul_kernel != BIGINT_KERNEL_C)
+		return words_addmul_1_adx(r, a, n, word);
+#endif
+	return words_addmul_1_c(r, a, n, word);
+}
+
+void bigint_set_kernel(int kernel, int *status)
+{
+	/* Kernels the processor lacks are refused and the current one
+	 * is kept. A kernel set also gets its multiplication thresholds,
+	 * the setters change them afterwards. cpuid is slow under
+	 * hypervisors, it is asked once.
+	 */
+	reset_flag_nullsafe(status);
+	static int best = BIGINT_KERNEL_AUTO;
+	if (best == BIGINT_KERNEL_AUTO) {
+#ifdef BIGINT_X86_64_KERNELS
+		best = cpu_kernel();
+		lanes_avx2 = cpu_avx2();
+#else
+		best = BIGINT_KERNEL_C;
+#endif
+	}
+	if (kernel == BIGINT_KERNEL_AUTO)
+		kernel = best;
+	if (kernel < BIGINT_KERNEL_C || kernel > best) {
+		set_flag_nullsafe(status, STATUS_ERROR_BAD_INPUT);
+		return;
+	}
+	mul_kernel = kernel;
+	const uint32_t *t = kernel_thresholds[kernel - BIGINT_KERNEL_C];
+	bigint_set_karatsuba_threshold(t[0]);
+	bigint_set_sqr_karatsuba_threshold(t[1]);
+	bigint_set_toom3_threshold(t[2]);
+	bigint_set_toom4_threshold(t[3]);
+	bigint_set_ntt_threshold(t[4]);
+}
+
+int bigint_get_kernel(void)
+{
+	return mul_kernel;
+}
+
+static void words_mul_basecase(limb_t *r, const limb_t *a, uint32_t na,
+			       const limb_t *b, uint32_t nb)
+{
+#ifdef BIGINT_X86_64_KERNELS
+	if (ifma_applies(na, nb, IFMA_THRESHOLD)) {
+		words_mul_ifma(r, a, na, b, nb);
+		return;
+	}
+	if (na > IFMA_MAX_LIMBS &&
+	    ifma_applies(IFMA_MAX_LIMBS, nb, IFMA_THRESHOLD)) {
+		/* Pieces of a short enough for the kernel times b */
+		limb_t prod[2 * IFMA_MAX_LIMBS];
+		memset(r, 0, (na + nb) * sizeof(limb_t));
+		for (uint32_t i = 0; i < na; i += IFMA_MAX_LIMBS) {
+			uint32_t n = MIN(IFMA_MAX_LIMBS, na - i);
+			words_mul_basecase(prod, a + i, n, b, nb);
+			words_add(r + i, r + i, na + nb - i, prod, n + nb);
+		}
+		return;
+	}
+#endif
+	memset(r, 0, (na + nb) * sizeof(limb_t));
+	for (uint32_t i = 0; i < nb; i++)
+		r[i + na] = words_addmul_1(r + i, a, na, b[i]);
+}
+
+static void words_mul_unbalanced(limb_t *r, const limb_t *a, uint32_t na,
+				 const limb_t *b, uint32_t nb, limb_t *tmp)
+{
+	/* Requires na >= 2 * nb, a is cut in pieces of nb words and each
+	 * piece is multiplied by b with the balanced algorithms.
+	 */
+	memset(r, 0, (na + nb) * sizeof(limb_t));
+	limb_t *prod = tmp;
+	for (uint32_t i = 0; i < na; i += nb) {
+		uint32_t n = MIN(nb, na - i);
+		words_mul(prod, a + i, n, b, nb, tmp + n + nb);
+		uint32_t carry = words_add(r + i, r + i, n + nb, prod, n + nb);
+		for (uint32_t j = i + n + nb; carry; j++) {
+			r[j] += 1;
+			carry = (r[j] == 0);
+		}
+	}
+}
+
+static void words_mul_karatsuba(limb_t *r, const limb_t *a, uint32_t na,
+				const limb_t *b, uint32_t nb, limb_t *tmp)
+{
+	/* Requires na >= nb > na / 2, splitting at h words:
+	 *   a * b = a1 b1 B^2h + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B^h
+	 *           + a0 b0
+	 */
+	uint32_t h = na >> 1;
+	uint32_t ha = na - h;
+	uint32_t hb = nb - h;
+	uint32_t la = ha + 1;
+	uint32_t lb = MAX(h, hb) + 1;
+	uint32_t lp = la + lb;
+	limb_t *sa = tmp;
+	limb_t *sb = sa + la;
+	limb_t *p = sb + lb;
+	int par = mul_parallel(na, nb);
+
+	words_mul_spawn(par, r, a, h, b, h, tmp);
+	words_mul_spawn(par, r + 2 * h, a + h, ha, b + h, hb, tmp);
+
+	sa[ha] = words_add(sa, a + h, ha, a, h);
+	if (hb >= h)
+		sb[hb] = words_add(sb, b + h, hb, b, h);
+	else
+		sb[h] = words_add(sb, b, h, b + h, hb);
+	words_mul(p, sa, la, sb, lb, p + lp);
+	mul_wait(par);
+
+	words_sub(p, p, lp, r, 2 * h);
+	words_sub(p, p, lp, r + 2 * h, ha + hb);
+
+	/* The middle term fits in the result, its top words are zero */
+	uint32_t rl = na + nb - h;
+	words_add(r + h, r + h, rl, p, MIN(lp, rl));
+}
+
+static void words_mul(limb_t *r, const limb_t *a, uint32_t na,
+		      const limb_t *b, uint32_t nb, limb_t *tmp)
+{
+	/* r[0..na+nb) <- a * b, r must not overlap the factors.
+	 * tmp holds at least mul_scratch_words(na, nb) words.
+	 */
+	if (a == b && na == nb) {
+		words_sqr(r, a, na, tmp);
+		return;
+	}
+	if (na < nb) {
+		const limb_t *aux = a;
+		a = b;
+		b = aux;
+		uint32_t naux = na;
+		na = nb;
+		nb = naux;
+	}
+	if (nb == 0) {
+		memset(r, 0, na * sizeof(limb_t));
+	} else if (nb >= ntt_threshold && ntt_piece_bits(na, nb)) {
+		words_mul_ntt(r, a, na, b, nb, tmp);
+	} else if (na >= 2 * nb && mul_parallel(na, nb)) {
+		words_mul_split(r, a, na, b, nb);
+	} else if (nb < karatsuba_threshold) {
+		words_mul_basecase(r, a, na, b, nb);
+	} else if (na >= 2 * nb) {
+		words_mul_unbalanced(r, a, na, b, nb, tmp);
+	} else if (nb < toom3_threshold) {
+		words_mul_karatsuba(r, a, na, b, nb, tmp);
+	} else if (nb < toom4_threshold) {
+		words_mul_toom3(r, a, na, b, nb, tmp);
+	} else {
+		words_mul_toom4(r, a, na, b, nb, tmp);
+	}
+}
+
+static int mul_parallel(uint32_t na, uint32_t nb)
+{
+	/* Products from parallel_threshold^2 words on split their work in
+	 * tasks, inside the region opened by words_mul_top or the one
+	 * the caller runs in.
+	 */
+#ifdef _OPENMP
+	uint64_t t = parallel_threshold;
+	return num_threads > 1 && (uint64_t) na * nb >= t * t &&
+	       omp_in_parallel();
+#else
+	(void) na;
+	(void) nb;
+	return 0;
+#endif
+}
+
+static limb_t *mul_scratch_alloc(uint32_t na, uint32_t nb)
+{
+	size_t ntmp = mul_scratch_words(na, nb);
+	return ntmp ? malloc(ntmp * sizeof(limb_t)) : NULL;
+}
+
+static void words_mul_spawn(int par, limb_t *r, const limb_t *a,
+			    uint32_t na, const limb_t *b, uint32_t nb,
+			    limb_t *tmp)
+{
+	/* words_mul, as a task with its own scratch when par is set.
+	 * The task is done after mul_wait.
+	 */
+	if (par) {
+		OMP_PRAGMA(omp task)
+		{
+			limb_t *own = mul_scratch_alloc(na, nb);
+			words_mul(r, a, na, b, nb, own);
+			free(own);
+		}
+	} else {
+		words_mul(r, a, na, b, nb, tmp);
+	}
+}
+
+static void tc_mul_spawn(int par, limb_t *r, uint32_t w, limb_t *x,
+			 limb_t *y, uint32_t e, limb_t *tmp)
+{
+	if (par) {
+		OMP_PRAGMA(omp task)
+		{
+			limb_t *own = mul_scratch_alloc(e - 1, e - 1);
+			tc_mul(r, w, x, y, e, own);
+			free(own);
+		}
+	} else {
+		tc_mul(r, w, x, y, e, tmp);
+	}
+}
+
+static void mul_wait(int par)
+{
+	if (par) {
+		OMP_PRAGMA(omp taskwait)
+	}
+}
+
+static void words_mul_split(limb_t *r, const limb_t *a, uint32_t na,
+			    const limb_t *b, uint32_t nb)
+{
+	/* Requires na >= 2 * nb, a is cut in a few chunks per thread, of
+	 * at least nb words, multiplied in parallel. The products of
+	 * the even chunks go to r and those of the odd ones to another
+	 * array, so no two tasks write the same words.
+	 */
+	uint32_t c = (na + 4 * num_threads - 1) / (4 * num_threads);
+	c = MAX(c, nb);
+	limb_t *odd = calloc(na + nb, sizeof(limb_t));
+	memset(r, 0, (na + nb) * sizeof(limb_t));
+	for (uint32_t i = 0; i < na; i += c) {
+		limb_t *dst = ((i / c) & 1) ? (odd + i) : (r + i);
+		uint32_t n = MIN(c, na - i);
+		OMP_PRAGMA(omp task)
+		{
+			if (nb < karatsuba_threshold) {
+				words_mul_basecase(dst, a + i, n, b, nb);
 			} else {
-				bigint_set_u32(res, 0);
-				int lmword = big->len;
-				for (int b = BITSXWORD - 1; b >= 0; b--) {
-					uint32_t i = (lmword << BXW_2K) + b;
-					uint32_t mask = (1 << b);
-					bigint_shift_left(res, 1);
-					if (big->bits[lmword] & mask)
-						bigint_set_lsbit(res);
-		    
-					if (bigint_compare(res, div) >= 0) {
-						bigint_subtract(res, div, NULL);
-						big->bits[lmword] |= mask; 
-					} else {
-						big->bits[lmword] &= ~mask; 
-					}
-				}
-				for (int w = lmword - 1; w >= 0; w--) {
-					if (big->bits[w] || bigint_gt(res, 0)) {
-						for (int b = BITSXWORD - 1; b >= 0; b--) {
-							uint32_t i = (w << BXW_2K) + b;
-							uint32_t mask = (1 << b);
-							bigint_shift_left(res, 1);
-							if (big->bits[w] & mask)
-								bigint_set_lsbit(res);
-		    
-							if (bigint_compare(res, div) >= 0) {
-								bigint_subtract(res, div, NULL);
-								big->bits[w] |= mask; 
-							} else {
-								big->bits[w] &= ~mask; 
-							}
-						}
-					}
+				size_t ntmp = 2 * (size_t) nb +
+					mul_scratch_words(nb, nb);
+				limb_t *own = malloc(ntmp * sizeof(limb_t));
+				words_mul_unbalanced(dst, a + i, n, b, nb, own);
+				free(own);
+			}
+		}
+	}
+	mul_wait(1);
+	words_add(r, r, na + nb, odd, na + nb);
+	free(odd);
+}
+
+static void words_mul_top(limb_t *r, const limb_t *a, uint32_t na,
+			  const limb_t *b, uint32_t nb, limb_t *tmp)
+{
+	/* words_mul of bigint_mul and bigint_sqr, in a team of
+	 * num_threads for products large enough to split.
+	 */
+#ifdef _OPENMP
+	uint64_t t = parallel_threshold;
+	if (num_threads > 1 && (uint64_t) na * nb >= t * t &&
+	    !omp_in_parallel()) {
+		OMP_PRAGMA(omp parallel num_threads(num_threads))
+		OMP_PRAGMA(omp single)
+		words_mul(r, a, na, b, nb, tmp);
+		return;
+	}
+#endif
+	words_mul(r, a, na, b, nb, tmp);
+}
+
+static uint32_t ntt_piece_bits(uint32_t na, uint32_t nb)
+{
+	/* Factors are cut in pieces of 32 bits while the convolution
+	 * coefficients, below min(na, nb) 2^64, fit the three primes.
+	 * Otherwise pieces of 16 bits. Returns 0 for products too long
+	 * for transforms of 2^NTT_MAX_2K points. Lengths are counted in
+	 * 32 bits pieces.
+	 */
+	uint64_t len = ((uint64_t) na + nb) * (BITSXWORD / 32);
+	uint64_t m = (uint64_t) MIN(na, nb) * (BITSXWORD / 32);
+	if (m <= (1U << 21) && len <= (1U << NTT_MAX_2K))
+		return 32;
+	else if (2 * len <= (1U << NTT_MAX_2K))
+		return 16;
+	else
+		return 0;
+}
+
+static uint32_t ntt_length(uint32_t na, uint32_t nb, uint32_t pbits)
+{
+	uint32_t len = (na + nb) * (BITSXWORD / pbits);
+	uint32_t n = 1;
+	while (n < len)
+		n <<= 1;
+	return n;
+}
+
+static uint32_t mod_pow_u32(uint32_t b, uint32_t e, uint32_t p)
+{
+	uint64_t r = 1;
+	uint64_t x = b % p;
+	while (e) {
+		if (e & 1)
+			r = r * x % p;
+		x = x * x % p;
+		e >>= 1;
+	}
+	return (uint32_t) r;
+}
+
+static uint32_t mont_redc(uint64_t t, uint32_t p, uint32_t pinv)
+{
+	/* t 2^-32 mod p for t < p 2^32, pinv = -1/p mod 2^32 */
+	uint32_t m = (uint32_t) t * pinv;
+	uint32_t u = (t + (uint64_t) m * p) >> 32;
+	return (u >= p) ? (u - p) : u;
+}
+
+static void ntt_load(uint32_t *x, uint32_t n, const limb_t *a,
+		     uint32_t na, uint32_t pbits, uint32_t p, int par)
+{
+	/* Piece i holds the bits [i pbits, (i + 1) pbits) of a */
+	uint32_t per = BITSXWORD / pbits;
+	uint32_t mask = (pbits == 32) ? 0xFFFFFFFF : 0xFFFF;
+	uint32_t m = na * per;
+#ifndef _OPENMP
+	(void) par;
+#endif
+	OMP_PRAGMA(omp taskloop if(par))
+	for (uint32_t i = 0; i < m; i++) {
+		uint32_t piece = (uint32_t) (a[i / per] >> (pbits * (i % per)));
+		x[i] = (piece & mask) % p;
+	}
+	memset(x + m, 0, (n - m) * sizeof(uint32_t));
+}
+
+static void ntt_forward_span(uint32_t *x, const uint32_t *w, uint32_t len,
+			     uint32_t st, uint32_t p, uint32_t pinv,
+			     uint32_t i, uint32_t end)
+{
+	/* Butterflies i to end of the level of half length len, the
+	 * butterfly i joins x[s + j] and x[s + j + len] for j = i % len
+	 * and s = 2 (i - j). Spans are whole blocks or part of one.
+	 */
+	uint32_t j = i & (len - 1);
+	uint32_t stop = (len > end - i) ? (j + end - i) : len;
+	for (uint32_t s = 2 * (i - j); s < 2 * end; s += 2 * len) {
+		uint32_t *x0 = x + s;
+		uint32_t *x1 = x0 + len;
+		for (uint32_t k = j; k < stop; k++) {
+			uint32_t u = x0[k];
+			uint32_t v = x1[k];
+			uint32_t sum = u + v;
+			x0[k] = (sum >= p) ? (sum - p) : sum;
+			x1[k] = mont_redc((uint64_t) (u + p - v) * w[k * st],
+					  p, pinv);
+		}
+	}
+}
+
+static void ntt_inverse_span(uint32_t *x, const uint32_t *w, uint32_t half,
+			     uint32_t len, uint32_t st, uint32_t p,
+			     uint32_t pinv, uint32_t i, uint32_t end)
+{
+	uint32_t j = i & (len - 1);
+	uint32_t stop = (len > end - i) ? (j + end - i) : len;
+	for (uint32_t s = 2 * (i - j); s < 2 * end; s += 2 * len) {
+		uint32_t *x0 = x + s;
+		uint32_t *x1 = x0 + len;
+		for (uint32_t k = j; k < stop; k++) {
+			uint32_t wk = k ? (p - w[half - k * st]) : w[0];
+			uint32_t u = x0[k];
+			uint32_t v = mont_redc((uint64_t) x1[k] * wk, p, pinv);
+			uint32_t sum = u + v;
+			x0[k] = (sum >= p) ? (sum - p) : sum;
+			x1[k] = (u >= v) ? (u - v) : (u + p - v);
+		}
+	}
+}
+
+static void ntt_forward(uint32_t *x, uint32_t n, const uint32_t *w,
+			uint32_t p, uint32_t pinv, int par)
+{
+	/* Decimation in frequency, the output is in bit reversed order.
+	 * w[i] holds the i-th power of the n-th root in Montgomery form.
+	 * With par set the butterflies of a level go in spans of
+	 * NTT_SPAN, run as tasks.
+	 */
+	uint32_t half = n >> 1;
+	for (uint32_t len = half, st = 1; len; len >>= 1, st <<= 1) {
+		if (!par) {
+			ntt_forward_span(x, w, len, st, p, pinv, 0, half);
+			continue;
+		}
+		OMP_PRAGMA(omp taskloop)
+		for (uint32_t i = 0; i < half; i += NTT_SPAN)
+			ntt_forward_span(x, w, len, st, p, pinv, i,
+					 MIN(i + NTT_SPAN, half));
+	}
+}
+
+static void ntt_inverse(uint32_t *x, uint32_t n, const uint32_t *w,
+			uint32_t p, uint32_t pinv, int par)
+{
+	/* Decimation in time from bit reversed order, without the 1/n
+	 * factor. The root powers w^-i are -w^(n/2-i).
+	 */
+	uint32_t half = n >> 1;
+	for (uint32_t len = 1, st = half; len < n; len <<= 1, st >>= 1) {
+		if (!par) {
+			ntt_inverse_span(x, w, half, len, st, p, pinv, 0, half);
+			continue;
+		}
+		OMP_PRAGMA(omp taskloop)
+		for (uint32_t i = 0; i < half; i += NTT_SPAN)
+			ntt_inverse_span(x, w, half, len, st, p, pinv, i,
+					 MIN(i + NTT_SPAN, half));
+	}
+}
+
+static void ntt_convolution(uint32_t *x, uint32_t *y, uint32_t *w,
+			   uint32_t n, int ip, const limb_t *a, uint32_t na,
+			   const limb_t *b, uint32_t nb, uint32_t pbits,
+			   int par)
+{
+	/* x <- a * b modulo the prime ip, y and w are scratch of n and
+	 * n / 2 words. A square takes a single forward transform. The
+	 * loops run as tasks when par is set, the root powers in spans
+	 * starting at w^s = root^s.
+	 */
+	uint32_t p = ntt_prime[ip];
+	uint32_t pinv = p;
+	for (int i = 0; i < 4; i++)
+		pinv *= 2 - p * pinv;
+	pinv = -pinv;
+
+	uint32_t r1 = (uint32_t) ((1ULL << 32) % p);
+	uint32_t r2 = (uint32_t) ((uint64_t) r1 * r1 % p);
+	uint32_t root = mod_pow_u32(ntt_generator[ip], (p - 1) / n, p);
+	uint32_t rm = (uint32_t) ((uint64_t) root * r1 % p);
+	uint32_t half = n >> 1;
+	OMP_PRAGMA(omp taskloop if(par))
+	for (uint32_t s = 0; s < half; s += NTT_SPAN) {
+		uint32_t end = MIN(s + NTT_SPAN, half);
+		w[s] = (uint32_t) ((uint64_t) mod_pow_u32(root, s, p) * r1 % p);
+		for (uint32_t i = s + 1; i < end; i++)
+			w[i] = mont_redc((uint64_t) w[i - 1] * rm, p, pinv);
+	}
+
+	ntt_load(x, n, a, na, pbits, p, par);
+	ntt_forward(x, n, w, p, pinv, par);
+	if (a == b && na == nb) {
+		OMP_PRAGMA(omp taskloop if(par))
+		for (uint32_t i = 0; i < n; i++)
+			x[i] = mont_redc((uint64_t) x[i] * x[i], p, pinv);
+	} else {
+		ntt_load(y, n, b, nb, pbits, p, par);
+		ntt_forward(y, n, w, p, pinv, par);
+		OMP_PRAGMA(omp taskloop if(par))
+		for (uint32_t i = 0; i < n; i++)
+			x[i] = mont_redc((uint64_t) x[i] * y[i], p, pinv);
+	}
+	ntt_inverse(x, n, w, p, pinv, par);
+
+	/* The pointwise products left a factor 2^-32, scale by 2^32 / n
+	 * in Montgomery form.
+	 */
+	uint32_t scale = mod_pow_u32(n, p - 2, p);
+	scale = (uint32_t) ((uint64_t) scale * r2 % p);
+	OMP_PRAGMA(omp taskloop if(par))
+	for (uint32_t i = 0; i < n; i++)
+		x[i] = mont_redc((uint64_t) x[i] * scale, p, pinv);
+}
+
+static void words_mul_ntt(limb_t *r, const limb_t *a, uint32_t na,
+			  const limb_t *b, uint32_t nb, limb_t *tmp)
+{
+	/* Convolution of the pieces modulo three primes, recombined with
+	 * the Garner algorithm:
+	 *   X = x0 + p0 (v1 + p1 v2)
+	 * and added at the position of each piece. The coefficients,
+	 * below 2^86, replace their residues (the low 64 bits in x0 and
+	 * x1, the rest in x2) before the carries run from the bottom.
+	 */
+	uint32_t pbits = ntt_piece_bits(na, nb);
+	uint32_t n = ntt_length(na, nb, pbits);
+	/* The residues take 32 bits whatever the limb size */
+	uint32_t *x[NTT_NPRIMES];
+	for (int ip = 0; ip < NTT_NPRIMES; ip++)
+		x[ip] = (uint32_t *) tmp + ip * n;
+	uint32_t *y = (uint32_t *) tmp + NTT_NPRIMES * n;
+	uint32_t *w = y + n;
+	int par = mul_parallel(na, nb);
+
+	for (int ip = 0; ip < NTT_NPRIMES; ip++)
+		ntt_convolution(x[ip], y, w, n, ip, a, na, b, nb, pbits, par);
+
+	uint64_t p0 = ntt_prime[0];
+	uint64_t p1 = ntt_prime[1];
+	uint64_t p2 = ntt_prime[2];
+	uint64_t c01 = mod_pow_u32(p0 % p1, p1 - 2, p1);
+	uint64_t c012 = mod_pow_u32((uint32_t) (p0 * p1 % p2), p2 - 2, p2);
+	uint64_t mask = (pbits == 32) ? 0xFFFFFFFF : 0xFFFF;
+	uint64_t lo = 0;
+	uint64_t hi = 0;
+	uint32_t per = BITSXWORD / pbits;
+	uint32_t npieces = (na + nb) * per;
+	uint32_t m = MIN(npieces, n);
+	OMP_PRAGMA(omp taskloop if(par))
+	for (uint32_t i = 0; i < m; i++) {
+		uint64_t x0 = x[0][i];
+		uint64_t v1 = (x[1][i] + p1 - x0 % p1) * c01 % p1;
+		uint64_t t = (x0 + v1 * p0) % p2;
+		uint64_t v2 = (x[2][i] + p2 - t) * c012 % p2;
+		uint64_t y = v1 + p1 * v2;
+		uint64_t l = (y & 0xFFFFFFFF) * p0 + x0;
+		uint64_t h = (y >> 32) * p0 + (l >> 32);
+		x[0][i] = (uint32_t) l;
+		x[1][i] = (uint32_t) h;
+		x[2][i] = (uint32_t) (h >> 32);
+	}
+	for (uint32_t i = 0; i < npieces; i++) {
+		if (i < n) {
+			uint64_t l = x[0][i] | ((uint64_t) x[1][i] << 32);
+			uint64_t h = x[2][i];
+			lo += l;
+			hi += h + (lo < l);
+		}
+		limb_t piece = (limb_t) (lo & mask);
+		lo = (lo >> pbits) | (hi << (64 - pbits));
+		hi >>= pbits;
+		if (i % per)
+			r[i / per] |= piece << (pbits * (i % per));
+		else
+			r[i / per] = piece;
+	}
+}
+
+static size_t mul_scratch_words(uint32_t na, uint32_t nb)
+{
+	/* Upper bound of the scratch used by words_mul and words_sqr.
+	 * Karatsuba and Toom take less than 6 n words per level for
+	 * pieces of at most n / 2 + 2 words, so 12 n covers the recursion.
+	 * A transform takes 4.5 times its length, which is below 36 n.
+	 */
+	uint32_t n = MAX(na, nb);
+	uint32_t m = MIN(na, nb);
+	if (m >= ntt_threshold && ntt_piece_bits(na, nb)) {
+		size_t len = ntt_length(na, nb, ntt_piece_bits(na, nb));
+		return (NTT_NPRIMES + 1) * len + len / 2;
+	} else if (m < MIN(karatsuba_threshold, sqr_karatsuba_threshold)) {
+		return 0;
+	} else if (n / 2 + 2 >= ntt_threshold) {
+		return 40 * (size_t) n + 512;
+	} else {
+		return 12 * (size_t) n + 512;
+	}
+}
+
+static void words_sqr_basecase(limb_t *r, const limb_t *a, uint32_t n)
+{
+	/* The products a[i] a[j] with i < j are accumulated once, doubled
+	 * with a shift and then the squares a[i]^2 are added.
+	 */
+#ifdef BIGINT_X86_64_KERNELS
+	if (ifma_applies(n, n, IFMA_SQR_THRESHOLD)) {
+		words_mul_ifma(r, a, n, a, n);
+		return;
+	}
+#endif
+	memset(r, 0, 2 * n * sizeof(limb_t));
+	for (uint32_t i = 0; i + 1 < n; i++)
+		r[i + n] = words_addmul_1(r + 2 * i + 1, a + i + 1,
+					  n - i - 1, a[i]);
+
+	for (uint32_t i = 2 * n - 1; i > 0; i--)
+		r[i] = (r[i] << 1) | (r[i - 1] >> (BITSXWORD - 1));
+	r[0] <<= 1;
+
+	dlimb_t sum = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		dlimb_t sq = (dlimb_t) a[i] * a[i];
+		sum += (dlimb_t) r[2 * i] + (limb_t) sq;
+		r[2 * i] = (limb_t) sum;
+		sum >>= BITSXWORD;
+		sum += (dlimb_t) r[2 * i + 1] + (sq >> BITSXWORD);
+		r[2 * i + 1] = (limb_t) sum;
+		sum >>= BITSXWORD;
+	}
+}
+
+static void words_sqr_karatsuba(limb_t *r, const limb_t *a, uint32_t n,
+				limb_t *tmp)
+{
+	/* a^2 = a1^2 B^2h + (a0^2 + a1^2 - (a1 - a0)^2) B^h + a0^2 */
+	uint32_t h = n >> 1;
+	uint32_t ha = n - h;
+	limb_t *d = tmp;
+	limb_t *p = d + ha;
+	int par = mul_parallel(n, n);
+
+	words_mul_spawn(par, r, a, h, a, h, tmp);
+	words_mul_spawn(par, r + 2 * h, a + h, ha, a + h, ha, tmp);
+
+	memset(d, 0, ha * sizeof(limb_t));
+	memcpy(d, a, h * sizeof(limb_t));
+	if (words_sub(d, a + h, ha, d, ha))
+		tc_neg(d, ha);
+	words_sqr(p, d, ha, p + 2 * ha + 1);
+	mul_wait(par);
+
+	/* p <- a0^2 + a1^2 - p in 2 ha + 1 words, non negative */
+	p[2 * ha] = -words_sub(p, r + 2 * h, 2 * ha, p, 2 * ha);
+	words_add(p, p, 2 * ha + 1, r, 2 * h);
+
+	words_add(r + h, r + h, 2 * n - h, p, MIN(2 * ha + 1, 2 * n - h));
+}
+
+static void words_sqr(limb_t *r, const limb_t *a, uint32_t n,
+		      limb_t *tmp)
+{
+	/* r[0..2n) <- a^2, tmp holds mul_scratch_words(n, n) words */
+	if (n >= ntt_threshold && ntt_piece_bits(n, n))
+		words_mul_ntt(r, a, n, a, n, tmp);
+	else if (n < sqr_karatsuba_threshold)
+		words_sqr_basecase(r, a, n);
+	else if (n < toom3_threshold)
+		words_sqr_karatsuba(r, a, n, tmp);
+	else if (n < toom4_threshold)
+		words_mul_toom3(r, a, n, a, n, tmp);
+	else
+		words_mul_toom4(r, a, n, a, n, tmp);
+}
+
+void bigint_sqr(const bigint_t *big, bigint_t *result)
+{
+	if (bigint_is_zero(big)) {
+		bigint_set_u32(result, 0);
+		return;
+	}
+
+	uint32_t n = big->len;
+	if (result->words < 2 * n)
+		bigint_duplicate_words(result, 2 * n);
+
+	bigint_set_u32(result, 0);
+	limb_t *tmp = NULL;
+	size_t ntmp = mul_scratch_words(n, n);
+	if (ntmp)
+		tmp = malloc(ntmp * sizeof(limb_t));
+	words_mul_top(result->bits, big->bits, n, big->bits, n, tmp);
+	free(tmp);
+	result->len = 2 * n;
+	bigint_update_len(result);
+}
+
+static void tc_neg(limb_t *x, uint32_t w)
+{
+	/* Two's complement negation of a w words number */
+	dlimb_t sum = 1;
+	for (uint32_t i = 0; i < w; i++) {
+		sum += (limb_t) ~x[i];
+		x[i] = (limb_t) sum;
+		sum >>= BITSXWORD;
+	}
+}
+
+static void tc_shl(limb_t *r, const limb_t *x, uint32_t w, uint32_t n)
+{
+	/* r <- x * 2^n modulo B^w, requires 0 < n < BITSXWORD */
+	for (uint32_t i = w - 1; i > 0; i--)
+		r[i] = (x[i] << n) | (x[i - 1] >> (BITSXWORD - n));
+	r[0] = x[0] << n;
+}
+
+static void tc_shr(limb_t *x, uint32_t w, uint32_t n)
+{
+	/* Arithmetic shift right, requires 0 < n < BITSXWORD */
+	for (uint32_t i = 0; i < w - 1; i++)
+		x[i] = (x[i] >> n) | (x[i + 1] << (BITSXWORD - n));
+	x[w - 1] = (limb_t) ((slimb_t) x[w - 1] >> n);
+}
+
+static void tc_divexact_1(limb_t *x, uint32_t w, uint32_t d)
+{
+	/* x <- x / d for an odd d dividing x, works on negative x because
+	 * it multiplies by the inverse of d modulo B^w. Each Newton step
+	 * doubles the 3 correct low bits of inv.
+	 */
+	limb_t inv = d;
+	for (int i = 0; i < BXW_2K - 1; i++)
+		inv *= 2 - d * inv;
+
+	limb_t borrow = 0;
+	for (uint32_t i = 0; i < w; i++) {
+		limb_t s = x[i] - borrow;
+		borrow = (s > x[i]);
+		limb_t q = s * inv;
+		x[i] = q;
+		borrow += (limb_t) (((dlimb_t) q * d) >> BITSXWORD);
+	}
+}
+
+static void tc_mul(limb_t *r, uint32_t w, limb_t *x, limb_t *y,
+		   uint32_t e, limb_t *tmp)
+{
+	/* r <- x * y, with x and y signed numbers of e words whose
+	 * magnitudes fit in e - 1 words. x and y are destroyed, they
+	 * may be the same array to get a square.
+	 */
+	int neg = 0;
+	if (x[e - 1] >> (BITSXWORD - 1)) {
+		tc_neg(x, e);
+		neg ^= 1;
+	}
+	if (y == x) {
+		neg = 0;
+	} else if (y[e - 1] >> (BITSXWORD - 1)) {
+		tc_neg(y, e);
+		neg ^= 1;
+	}
+	words_mul(r, x, e - 1, y, e - 1, tmp);
+	memset(r + 2 * (e - 1), 0, (w - 2 * (e - 1)) * sizeof(limb_t));
+	if (neg)
+		tc_neg(r, w);
+}
+
+static void add_at(limb_t *r, uint32_t nr, uint32_t off,
+		   const limb_t *c, uint32_t w)
+{
+	/* r <- r + c * B^off, the words of c beyond nr are known zeros */
+	if (off < nr)
+		words_add(r + off, r + off, nr - off, c, MIN(w, nr - off));
+}
+
+static void toom_parts_len(uint32_t n, uint32_t k, uint32_t np,
+			   uint32_t *len)
+{
+	for (uint32_t i = 0; i < np; i++) {
+		if (n > i * k)
+			len[i] = (i + 1 < np) ? MIN(k, n - i * k) : n - i * k;
+		else
+			len[i] = 0;
+	}
+}
+
+static void toom3_eval(limb_t *ev, uint32_t e, const limb_t *a,
+		       uint32_t k, const uint32_t *len)
+{
+	/* ev <- [a(1), a(-1), a(-2)], each one of e words */
+	limb_t *p1 = ev;
+	limb_t *pm1 = p1 + e;
+	limb_t *pm2 = pm1 + e;
+	const limb_t *a0 = a;
+	const limb_t *a1 = a + k;
+	const limb_t *a2 = a + 2 * k;
+
+	memset(pm1, 0, e * sizeof(limb_t));
+	memcpy(pm1, a0, len[0] * sizeof(limb_t));
+	words_add(pm1, pm1, e, a2, len[2]);
+	words_add(p1, pm1, e, a1, len[1]);
+	words_sub(pm1, pm1, e, a1, len[1]);
+	words_add(pm2, pm1, e, a2, len[2]);
+	tc_shl(pm2, pm2, e, 1);
+	words_sub(pm2, pm2, e, a0, len[0]);
+}
+
+static void words_mul_toom3(limb_t *r, const limb_t *a, uint32_t na,
+			    const limb_t *b, uint32_t nb, limb_t *tmp)
+{
+	/* Requires na >= nb > na / 2. Pieces of k words are the
+	 * coefficients of polynomials evaluated at 0, 1, -1, -2 and inf,
+	 * the product coefficients are interpolated with the sequence of
+	 * Bodrato. Intermediate values are two's complement numbers of
+	 * w words.
+	 */
+	uint32_t k = (na + 2) / 3;
+	uint32_t e = k + 2;
+	uint32_t w = 2 * k + 4;
+	uint32_t nr = na + nb;
+	uint32_t la[3], lb[3];
+	toom_parts_len(na, k, 3, la);
+	toom_parts_len(nb, k, 3, lb);
+
+	limb_t *ea = tmp;
+	limb_t *eb = ea + 3 * e;
+	limb_t *v1 = ea + 6 * e;
+	limb_t *vm1 = v1 + w;
+	limb_t *vm2 = vm1 + w;
+	limb_t *next = vm2 + w;
+
+	toom3_eval(ea, e, a, k, la);
+	if (a == b && na == nb)
+		eb = ea;
+	else
+		toom3_eval(eb, e, b, k, lb);
+	int par = mul_parallel(na, nb);
+	tc_mul_spawn(par, v1, w, ea, eb, e, next);
+	tc_mul_spawn(par, vm1, w, ea + e, eb + e, e, next);
+	tc_mul_spawn(par, vm2, w, ea + 2 * e, eb + 2 * e, e, next);
+
+	const limb_t *r0 = r;
+	const limb_t *rinf = r + 4 * k;
+	uint32_t li = 0;
+	if (lb[2]) {
+		li = la[2] + lb[2];
+		words_mul_spawn(par, r + 4 * k, a + 2 * k, la[2],
+				b + 2 * k, lb[2], next);
+	}
+	words_mul(r, a, k, b, k, next);
+	mul_wait(par);
+
+	words_sub(vm2, vm2, w, v1, w);
+	tc_divexact_1(vm2, w, 3);
+	words_sub(v1, v1, w, vm1, w);
+	tc_shr(v1, w, 1);
+	words_sub(vm1, vm1, w, r0, 2 * k);
+	words_sub(vm2, vm1, w, vm2, w);
+	tc_shr(vm2, w, 1);
+	words_add(vm2, vm2, w, rinf, li);
+	words_add(vm2, vm2, w, rinf, li);
+	words_add(vm1, vm1, w, v1, w);
+	words_sub(vm1, vm1, w, rinf, li);
+	words_sub(v1, v1, w, vm2, w);
+
+	/* v1, vm1 and vm2 hold the coefficients 1, 2 and 3 */
+	uint32_t mid = li ? MIN(4 * k, nr) : nr;
+	memset(r + 2 * k, 0, (mid - 2 * k) * sizeof(limb_t));
+	add_at(r, nr, k, v1, w);
+	add_at(r, nr, 2 * k, vm1, w);
+	add_at(r, nr, 3 * k, vm2, w);
+}
+
+static void toom4_eval(limb_t *ev, uint32_t e, const limb_t *a,
+		       uint32_t k, const uint32_t *len)
+{
+	/* ev <- [a(1), a(-1), a(2), a(-2), 8 a(1/2)], each one of e words */
+	limb_t *p1 = ev;
+	limb_t *pm1 = p1 + e;
+	limb_t *p2 = pm1 + e;
+	limb_t *pm2 = p2 + e;
+	limb_t *ph = pm2 + e;
+	const limb_t *a0 = a;
+	const limb_t *a1 = a + k;
+	const limb_t *a2 = a + 2 * k;
+	const limb_t *a3 = a + 3 * k;
+
+	/* pm1 <- a0 + a2, ph <- a1 + a3 */
+	memset(pm1, 0, e * sizeof(limb_t));
+	memcpy(pm1, a0, len[0] * sizeof(limb_t));
+	words_add(pm1, pm1, e, a2, len[2]);
+	memset(ph, 0, e * sizeof(limb_t));
+	memcpy(ph, a1, len[1] * sizeof(limb_t));
+	words_add(ph, ph, e, a3, len[3]);
+	words_add(p1, pm1, e, ph, e);
+	words_sub(pm1, pm1, e, ph, e);
+
+	/* pm2 <- a0 + 4 a2, ph <- 2 a1 + 8 a3 */
+	memset(pm2, 0, e * sizeof(limb_t));
+	memcpy(pm2, a2, len[2] * sizeof(limb_t));
+	tc_shl(pm2, pm2, e, 2);
+	words_add(pm2, pm2, e, a0, len[0]);
+	memset(ph, 0, e * sizeof(limb_t));
+	memcpy(ph, a3, len[3] * sizeof(limb_t));
+	tc_shl(ph, ph, e, 2);
+	words_add(ph, ph, e, a1, len[1]);
+	tc_shl(ph, ph, e, 1);
+	words_add(p2, pm2, e, ph, e);
+	words_sub(pm2, pm2, e, ph, e);
+
+	/* ph <- ((2 a0 + a1) 2 + a2) 2 + a3 */
+	memset(ph, 0, e * sizeof(limb_t));
+	memcpy(ph, a0, len[0] * sizeof(limb_t));
+	tc_shl(ph, ph, e, 1);
+	words_add(ph, ph, e, a1, len[1]);
+	tc_shl(ph, ph, e, 1);
+	words_add(ph, ph, e, a2, len[2]);
+	tc_shl(ph, ph, e, 1);
+	words_add(ph, ph, e, a3, len[3]);
+}
+
+static void words_mul_toom4(limb_t *r, const limb_t *a, uint32_t na,
+			    const limb_t *b, uint32_t nb, limb_t *tmp)
+{
+	/* Requires na >= nb > na / 2. Same scheme than words_mul_toom3
+	 * with four pieces, evaluated at 0, 1, -1, 2, -2, 1/2 and inf.
+	 * With c0 and c6 known, the even coefficients come from the
+	 * points +-1 and +-2 and the odd ones from those and 1/2.
+	 */
+	uint32_t k = (na + 3) / 4;
+	uint32_t e = k + 2;
+	uint32_t w = 2 * k + 4;
+	uint32_t nr = na + nb;
+	uint32_t la[4], lb[4];
+	toom_parts_len(na, k, 4, la);
+	toom_parts_len(nb, k, 4, lb);
+
+	limb_t *ea = tmp;
+	limb_t *eb = ea + 5 * e;
+	limb_t *v1 = ea + 10 * e;
+	limb_t *vm1 = v1 + w;
+	limb_t *v2 = vm1 + w;
+	limb_t *vm2 = v2 + w;
+	limb_t *vh = vm2 + w;
+	limb_t *t = vh + w;
+	limb_t *next = t + w;
+
+	toom4_eval(ea, e, a, k, la);
+	if (a == b && na == nb)
+		eb = ea;
+	else
+		toom4_eval(eb, e, b, k, lb);
+	int par = mul_parallel(na, nb);
+	for (uint32_t i = 0; i < 5; i++)
+		tc_mul_spawn(par, v1 + i * w, w, ea + i * e, eb + i * e, e,
+			     next);
+
+	const limb_t *r0 = r;
+	const limb_t *rinf = r + 6 * k;
+	uint32_t li = 0;
+	if (lb[3]) {
+		li = la[3] + lb[3];
+		words_mul_spawn(par, r + 6 * k, a + 3 * k, la[3],
+				b + 3 * k, lb[3], next);
+	}
+	words_mul(r, a, k, b, k, next);
+	mul_wait(par);
+
+	/* vm1 <- o1 = c1 + c3 + c5, v1 <- c2 + c4 */
+	words_sub(vm1, v1, w, vm1, w);
+	tc_shr(vm1, w, 1);
+	words_sub(v1, v1, w, vm1, w);
+	words_sub(v1, v1, w, r0, 2 * k);
+	words_sub(v1, v1, w, rinf, li);
+
+	/* vm2 <- o2 = c1 + 4 c3 + 16 c5, v2 <- c2 + 4 c4 */
+	words_sub(vm2, v2, w, vm2, w);
+	tc_shr(vm2, w, 2);
+	words_sub(v2, v2, w, vm2, w);
+	words_sub(v2, v2, w, vm2, w);
+	words_sub(v2, v2, w, r0, 2 * k);
+	words_sub_1(v2 + li, v2 + li, w - li,
+		    words_sublsh_n(v2, v2, rinf, li, 6));
+	tc_shr(v2, w, 2);
+
+	/* v2 <- c4, v1 <- c2 */
+	words_sub(v2, v2, w, v1, w);
+	tc_divexact_1(v2, w, 3);
+	words_sub(v1, v1, w, v2, w);
+
+	/* vh <- 16 c1 + 4 c3 + c5 */
+	words_sub_1(vh + 2 * k, vh + 2 * k, w - 2 * k,
+		    words_sublsh_n(vh, vh, r0, 2 * k, 6));
+	words_sublsh_n(vh, vh, v1, w, 4);
+	words_sublsh_n(vh, vh, v2, w, 2);
+	words_sub(vh, vh, w, rinf, li);
+	tc_shr(vh, w, 1);
+
+	/* vm2 <- c3 + 5 c5, vh <- 5 c1 + c3 */
+	words_sub(vm2, vm2, w, vm1, w);
+	tc_divexact_1(vm2, w, 3);
+	words_sub(vh, vh, w, vm1, w);
+	tc_divexact_1(vh, w, 3);
+
+	/* vh <- c5 = (5 c1 + c3 + 4 (c3 + 5 c5) - 5 o1) / 15 */
+	words_addlsh_n(vh, vh, vm2, w, 2);
+	words_sublsh_n(vh, vh, vm1, w, 2);
+	words_sub(vh, vh, w, vm1, w);
+	tc_divexact_1(vh, w, 15);
+
+	/* vm1 <- c1 = o1 - (c3 + 5 c5) + 4 c5, vm2 <- c3 */
+	words_sub(vm1, vm1, w, vm2, w);
+	words_addlsh_n(vm1, vm1, vh, w, 2);
+	words_sublsh_n(vm2, vm2, vh, w, 2);
+	words_sub(vm2, vm2, w, vh, w);
+
+	uint32_t mid = li ? MIN(6 * k, nr) : nr;
+	memset(r + 2 * k, 0, (mid - 2 * k) * sizeof(limb_t));
+	add_at(r, nr, k, vm1, w);
+	add_at(r, nr, 2 * k, v1, w);
+	add_at(r, nr, 3 * k, vm2, w);
+	add_at(r, nr, 4 * k, v2, w);
+	add_at(r, nr, 5 * k, vh, w);
+}
+
+void bigint_div_u32(bigint_t *big, uint32_t div, uint32_t *res)
+{
+	if (!div) {
+		/* PENDING: Set infty */
+		bigint_set_max(big);
+		*res = 0;
+	} else {
+		*res = 0;
+		int32_t lmword = big->len - 1;
+		for (int64_t i = lmword; i >= 0; i--) {
+			dlimb_t aux = (dlimb_t)(*res) << BITSXWORD;
+			*res = (aux + big->bits[i]) % div;
+			big->bits[i] = (aux + big->bits[i]) / div;
+		}
+		bigint_update_len(big);
+	}
+}
+
+void bigint_div_u64(bigint_t *big, uint64_t div, uint64_t *res)
+{
+	if (!div) {
+		/* PENDING: Set infty */
+		bigint_set_max(big);
+		*res = 0;
+#ifdef BIGINT_LIMB64
+	} else {
+		*res = words_divrem_1(big->bits, big->bits, big->len, div);
+		bigint_update_len(big);
+	}
+#else
+	} else if (!(div >> BITSXWORD)) {
+		*res = words_divrem_1(big->bits, big->bits, big->len,
+				      (uint32_t) div);
+		bigint_update_len(big);
+	} else if (big->len < 2) {
+		*res = bigint_truncate_u64(big);
+		bigint_set_u32(big, 0);
+	} else {
+		/* Long division by a normalized two word divisor, 64 by 32
+		 * bits divisions only.
+		 */
+		uint32_t n = big->len;
+		uint32_t s = BITSXWORD - 1 -
+			index_of_msbit_in_word((uint32_t) (div >> BITSXWORD));
+		uint64_t dn = div << s;
+		limb_t vn[2] = {(limb_t) dn, (limb_t) (dn >> BITSXWORD)};
+		limb_t *un = malloc((n + 1) * sizeof(limb_t));
+		un[n] = words_lshift(un, big->bits, n, s);
+		words_divrem(big->bits, un, n, vn, 2);
+		big->bits[n - 1] = 0;
+		words_rshift(un, un, 2, s);
+		*res = ((uint64_t) un[1] << BITSXWORD) | un[0];
+		free(un);
+		bigint_update_len(big);
+	}
+#endif
+}
+
+void bigint_div_2k(bigint_t *big, uint32_t k)
+{
+	bigint_shift_right(big, k);
+}
+
+static limb_t words_lshift(limb_t *r, const limb_t *a, uint32_t n,
+			   uint32_t s)
+{
+	/* r[0..n) <- a * 2^s, returns the bits shifted out. s < BITSXWORD */
+	if (!s) {
+		memmove(r, a, n * sizeof(limb_t));
+		return 0;
+	}
+	limb_t out = a[n - 1] >> (BITSXWORD - s);
+	for (uint32_t i = n - 1; i > 0; i--)
+		r[i] = (a[i] << s) | (a[i - 1] >> (BITSXWORD - s));
+	r[0] = a[0] << s;
+	return out;
+}
+
+static void words_rshift(limb_t *r, const limb_t *a, uint32_t n,
+			 uint32_t s)
+{
+	/* r[0..n) <- a / 2^s, requires s < BITSXWORD */
+	if (!s) {
+		memmove(r, a, n * sizeof(limb_t));
+		return;
+	}
+	for (uint32_t i = 0; i < n - 1; i++)
+		r[i] = (a[i] >> s) | (a[i + 1] << (BITSXWORD - s));
+	r[n - 1] = a[n - 1] >> s;
+}
+
+static limb_t words_divrem_1(limb_t *q, const limb_t *u, uint32_t n,
+			     limb_t d)
+{
+	/* q[0..n) <- u / d, returns u % d. q may be u or NULL */
+	dlimb_t rem = 0;
+	for (uint32_t i = n; i-- > 0;) {
+		rem = (rem << BITSXWORD) | u[i];
+		if (q)
+			q[i] = (limb_t) (rem / d);
+		rem %= d;
+	}
+	return (limb_t) rem;
+}
+
+static void words_divrem(limb_t *q, limb_t *u, uint32_t nu,
+			 const limb_t *v, uint32_t nv)
+{
+	/* Knuth's algorithm D. u holds nu + 1 words and v is normalized,
+	 * nv >= 2 and its top bit set. Writes q[0..nu-nv] unless q is
+	 * NULL and leaves the remainder in u[0..nv).
+	 */
+	dlimb_t vtop = v[nv - 1];
+	dlimb_t vnext = v[nv - 2];
+	for (uint32_t j = nu - nv + 1; j-- > 0;) {
+		/* The estimate from the top two words of u and the top word
+		 * of v is at most two above the quotient word, checking the
+		 * next word makes the add back below rare.
+		 */
+		dlimb_t num = ((dlimb_t) u[j + nv] << BITSXWORD) |
+			u[j + nv - 1];
+		dlimb_t qhat = num / vtop;
+		dlimb_t rhat = num % vtop;
+		while ((qhat >> BITSXWORD) || qhat * vnext >
+		       ((rhat << BITSXWORD) | u[j + nv - 2])) {
+			qhat--;
+			rhat += vtop;
+			if (rhat >> BITSXWORD)
+				break;
+		}
+
+		limb_t borrow = words_submul_1(u + j, v, nv, (limb_t) qhat);
+		if (u[j + nv] < borrow) {
+			qhat--;
+			borrow -= words_add(u + j, u + j, nv, v, nv);
+		}
+		u[j + nv] -= borrow;
+		if (q)
+			q[j] = (limb_t) qhat;
+	}
+}
+
+static void bigint_divrem(bigint_t *q, bigint_t *r, const bigint_t *u,
+			  const bigint_t *v)
+{
+	/* q <- u / v and r <- u % v for u >= v > 0. q may be u or NULL,
+	 * r must be another bigint than u and v.
+	 */
+	uint32_t nu = u->len;
+	uint32_t nv = v->len;
+	bigint_set_u32(r, 0);
+	if (q && q != u)
+		bigint_set_u32(q, 0);
+	if (r->words < nu + 1)
+		bigint_duplicate_words(r, nu + 1);
+	if (q && q->words < nu)
+		bigint_duplicate_words(q, nu);
+
+	if (nv == 1) {
+		r->bits[0] = words_divrem_1(q ? q->bits : NULL,
+					    u->bits, nu, v->bits[0]);
+		r->len = (r->bits[0] != 0);
+	} else {
+		/* Normalize so the top bit of the divisor is set, the
+		 * shifted dividend goes to r and the quotient to q.
+		 */
+		uint32_t s = BITSXWORD - 1 - index_of_msbit_in_word(v->bits[nv - 1]);
+		limb_t *vn = malloc(nv * sizeof(limb_t));
+		limb_t *un = r->bits;
+		words_lshift(vn, v->bits, nv, s);
+		un[nu] = words_lshift(un, u->bits, nu, s);
+
+		words_divrem(q ? q->bits : NULL, un, nu, vn, nv);
+		free(vn);
+
+		words_rshift(un, un, nv, s);
+		r->len = nv;
+		bigint_update_len(r);
+	}
+
+	if (q) {
+		q->len = nu - nv + 1;
+		bigint_update_len(q);
+	}
+}
+
+static void bigint_recip(bigint_t *res, const bigint_t *m)
+{
+	/* res <- floor(2^(2 L) / m) for m > 0 of L bits. Newton's
+	 * iteration from the reciprocal of the top half of m, so it
+	 * costs a few products instead of a long division.
+	 */
+	uint32_t L = bigint_index_of_msbit(m) + 1;
+	bigint_t *u = bigint_alloc(2 * m->len + 2);
+	bigint_t *t = bigint_alloc(2 * m->len + 2);
+	if (m->len <= karatsuba_threshold) {
+		bigint_add_2k(u, 2 * L);
+		bigint_divrem(res, t, u, m);
+		bigint_destroy(u);
+		bigint_destroy(t);
+		return;
+	}
+
+	/* x0 = (2^(2 Lh) / (floor(m / 2^s) + 1)) 2^e is below the
+	 * reciprocal X by at most 5 2^s. One step x1 = x0 + x0 (2^(2 L)
+	 * - m x0) / 2^(2 L) stays below X, and with h over L / 2 + 2
+	 * bits by at most three.
+	 */
+	uint32_t h = (L + 1) / 2 + 2;
+	uint32_t s = L - h;
+	bigint_t *x = bigint_alloc(m->len + 2);
+	bigint_copy(t, m);
+	bigint_shift_right(t, s);
+	bigint_increment(t);
+	uint32_t lh = bigint_index_of_msbit(t) + 1;
+	bigint_recip(x, t);
+	bigint_shift_left(x, L + h - 2 * lh);
+
+	bigint_mul(m, x, t);
+	bigint_add_2k(u, 2 * L);
+	bigint_subtract(u, t, NULL);
+	bigint_mul(x, u, t);
+	bigint_shift_right(t, 2 * L);
+	bigint_add(x, t);
+
+	bigint_mul(m, x, t);
+	bigint_set_u32(u, 0);
+	bigint_add_2k(u, 2 * L);
+	bigint_subtract(u, t, NULL);
+	while (bigint_compare(u, m) >= 0) {
+		bigint_subtract(u, m, NULL);
+		bigint_increment(x);
+	}
+	bigint_copy(res, x);
+	bigint_destroy(x);
+	bigint_destroy(u);
+	bigint_destroy(t);
+}
+
+void bigint_div(bigint_t *big, const bigint_t *div, bigint_t *res)
+{
+	if (bigint_is_zero(div)) {
+		/* PENDING: Set infty */
+		bigint_set_max(big);
+		bigint_set_u32(res, 0);
+	} else {
+		int cmp = bigint_compare(big, div);
+		if (cmp == 0) {
+			bigint_set_u32(big, 1);
+			bigint_set_u32(res, 0);
+		} else if (cmp < 0) {
+			bigint_copy(res, big);
+			bigint_set_u32(big, 0);
+		} else {
+			bigint_divrem(big, res, big, div);
+		}
+	}
+}
+
+void bigint_div_2kless1(bigint_t *big, uint32_t k, bigint_t *res)
+{
+	bigint_copy(res, big);
+	bigint_set_u32(big, 0);
+	
+	while (bigint_compare_2k(res, k) >= 0) {
+		add_N_div2k(big, res, k);
+		set_div2k_plus_res2k(res, k);
+	}
+
+	if (bigint_compare_2kless1(res, k) >= 0) {
+		bigint_add_u32(big, 1);
+		bigint_add_u32(res, 1);
+		bigint_subtract_2k(res, k, NULL);
+	}
+}
+
+static void add_N_mul2k(bigint_t *big, const bigint_t *add, uint32_t k)
+{
+	/* Return big + adding * 2k */
+	uint32_t iword = k >> BXW_2K;
+	uint32_t ibit = k & BXW_MOD_MASK;
+	uint32_t n = add->len;
+	if (!n)
+		return;
+        
+	uint32_t len = MAX(big->len, n + iword);
+	if (len >= big->words)
+		bigint_duplicate_words(big, len + 1);
+	if (len > big->len)
+		memset(big->bits + big->len, 0,
+		       (len - big->len) * sizeof(limb_t));
+
+	limb_t *r = big->bits + iword;
+	limb_t carry;
+	if (ibit)
+		carry = words_addlsh_n(r, r, add->bits, n, ibit);
+	else
+		carry = words_add_n(r, r, add->bits, n);
+	big->bits[len] = words_add_1(r + n, r + n, len - iword - n, carry);
+	big->len = len + 1;
+	bigint_update_len(big);
+}
+
+static void add_N_div2k(bigint_t *big, const bigint_t *add, uint32_t k)
+{
+	/* Return big + adding / 2k */
+	uint32_t iword = k >> BXW_2K;
+	if (iword >= add->len)
+		return;
+	
+	uint32_t m = add->len - iword;
+	limb_t *sh = malloc(m * sizeof(limb_t));
+	words_rshift(sh, add->bits + iword, m, k & BXW_MOD_MASK);
+	if (!sh[m - 1])
+		m --;
+	bigint_t aux = {m, m, sh, NULL, {0}};
+	bigint_add(big, &aux);
+	free(sh);
+}
+
+static void set_div2k_plus_res2k(bigint_t *big, uint32_t k)
+{
+	/* Return big / 2k + big % 2k
+	 * Example:
+	 *  Big: 101101101111
+	 *            ^
+	 *    k: 6
+	 *  Big / k:  101101
+	 *  Big % k:  101111
+	 *  Result : 1011100
+	 */
+	uint32_t iword = k >> BXW_2K;
+	if (k == 0 || iword >= big->len)
+		return;
+	
+	uint32_t m = big->len - iword;
+	limb_t *sh = malloc(m * sizeof(limb_t));
+	words_rshift(sh, big->bits + iword, m, k & BXW_MOD_MASK);
+	if (!sh[m - 1])
+		m --;
+
+	/* big <- big % 2k, then plus the shifted copy */
+	big->bits[iword] &= ((limb_t) 1 << (k & BXW_MOD_MASK)) - 1;
+	big->len = iword + 1;
+	bigint_update_len(big);
+	bigint_t aux = {m, m, sh, NULL, {0}};
+	bigint_add(big, &aux);
+	free(sh);
+}
+
+void bigint_div_fast(bigint_t *big, const bigint_t *div, bigint_t *res,
+		     bigint_t *aux1, bigint_t *aux2, bigint_t *aux3)
+{
+	/* Same as bigint_div, the auxiliary structures are not needed
+	 * anymore by the word level long division.
+	 */
+	(void) aux1;
+	(void) aux2;
+	(void) aux3;
+	bigint_div(big, div, res);
+}
+
+void bigint_mod_2k(bigint_t *big, uint32_t k)
+{
+	uint32_t iw = k >> BXW_2K;
+	if (iw >= big->len)
+		return;
+
+	big->bits[iw] &= ((limb_t) 1 << (k & BXW_MOD_MASK)) - 1;
+	big->len = iw + 1;
+	bigint_update_len(big);
+}
+
+void bigint_mod_2kless1(bigint_t *big, uint32_t k)
+{
+	while (bigint_compare_2k(big, k) >= 0) {
+		set_div2k_plus_res2k(big, k);
+	}
+
+	if (bigint_compare_2kless1(big, k) >= 0) {
+		bigint_add_u32(big, 1);
+		bigint_subtract_2k(big, k, NULL);
+	}
+}
+
+void bigint_mod(bigint_t *big, const bigint_t *div,
+		bigint_t *aux1, bigint_t *aux2, bigint_t *aux3)
+{
+	/* Auxiliary structures used in computation:
+	 *   > aux1 (remainder of the long division)
+	 *   > aux2 and aux3 are not used
+	 */
+	(void) aux2;
+	(void) aux3;
+	if (bigint_is_zero(div)) {
+		/* PENDING: Set infty */
+		bigint_set_u32(big, 0);
+	} else if (bigint_compare(big, div) >= 0) {
+		bigint_divrem(NULL, aux1, big, div);
+		bigint_copy(big, aux1);
+	}
+}
+
+bigint_barrett_t *bigint_barrett_create(const bigint_t *mod)
+{
+	if (bigint_is_zero(mod))
+		return NULL;
+
+	uint32_t n = mod->len;
+	bigint_barrett_t *ctx = malloc(sizeof(*ctx));
+	ctx->n = n;
+	ctx->m = malloc(n * sizeof(limb_t));
+	memcpy(ctx->m, mod->bits, n * sizeof(limb_t));
+
+	/* mu has n + 1 words, or n + 2 when the modulus is a power of
+	 * the limb base B.
+	 */
+	bigint_t *mu = bigint_alloc(2 * n + 2);
+	bigint_t *rem = bigint_alloc(2 * n + 2);
+	bigint_add_2k(mu, 2 * n * BITSXWORD);
+	bigint_divrem(mu, rem, mu, mod);
+	ctx->nmu = mu->len;
+	ctx->mu = malloc(ctx->nmu * sizeof(limb_t));
+	memcpy(ctx->mu, mu->bits, ctx->nmu * sizeof(limb_t));
+	bigint_destroy(mu);
+	bigint_destroy(rem);
+
+	ctx->x = malloc(2 * n * sizeof(limb_t));
+	ctx->q = malloc((4 * n + 5) * sizeof(limb_t));
+	ctx->tmp = NULL;
+	ctx->ntmp = 0;
+	barrett_reserve(ctx, n, n);
+	return ctx;
+}
+
+void bigint_barrett_destroy(bigint_barrett_t *ctx)
+{
+	if (!ctx)
+		return;
+	free(ctx->m);
+	free(ctx->mu);
+	free(ctx->x);
+	free(ctx->q);
+	free(ctx->tmp);
+	free(ctx);
+}
+
+static void barrett_reserve(bigint_barrett_t *ctx, uint32_t na, uint32_t nb)
+{
+	/* Scratch for the reduction and a product of na by nb words. It
+	 * depends on the multiplication thresholds, so it only grows again
+	 * if they are changed after the context is created.
+	 */
+	uint32_t n = ctx->n;
+	size_t ntmp = mul_scratch_words(n + 1, ctx->nmu);
+	ntmp = MAX(ntmp, mul_scratch_words(ctx->nmu, n));
+	ntmp = MAX(ntmp, mul_scratch_words(na, nb));
+	if (ntmp > ctx->ntmp) {
+		free(ctx->tmp);
+		ctx->tmp = malloc(ntmp * sizeof(limb_t));
+		ctx->ntmp = ntmp;
+	}
+}
+
+static void barrett_reduce_x(bigint_barrett_t *ctx)
+{
+	/* x <- x mod m for x < B^(2 n), the remainder is left in the
+	 * low n words of x and the high ones are cleared. Takes two
+	 * products and at most three final subtractions.
+	 */
+	uint32_t n = ctx->n;
+	uint32_t nmu = ctx->nmu;
+	limb_t *x = ctx->x;
+	limb_t *q = ctx->q;
+	limb_t *r = q + 2 * n + 3;
+
+	/* q3 = floor(floor(x / B^(n-1)) mu / B^(n+1)) with B = 2^BITSXWORD is
+	 * the quotient or falls short by at most two.
+	 */
+	if (n + 1 < toom3_threshold) {
+		/* Up to Karatsuba sizes two half products beat two full
+		 * ones. Skipping the words below n - 1 of q1 mu makes q3
+		 * short by one more at most, and q3 m is only needed
+		 * modulo B^(n+1).
+		 */
+		const limb_t *q1 = x + n - 1;
+		memset(q, 0, (n + 1 + nmu) * sizeof(limb_t));
+		for (uint32_t i = 0; i <= n; i++) {
+			uint32_t j = (i < n - 1) ? n - 1 - i : 0;
+			if (j < nmu)
+				q[i + nmu] = words_addmul_1(q + i + j, ctx->mu + j,
+							    nmu - j, q1[i]);
+		}
+		memset(r, 0, (n + 1) * sizeof(limb_t));
+		for (uint32_t i = 0; i < MIN(nmu, n + 1); i++) {
+			uint32_t len = MIN(n, n + 1 - i);
+			limb_t c = words_addmul_1(r + i, ctx->m, len, q[n + 1 + i]);
+			if (i + len <= n)
+				r[i + len] += c;
+		}
+	} else {
+		words_mul(q, x + n - 1, n + 1, ctx->mu, nmu, ctx->tmp);
+		words_mul(r, q + n + 1, nmu, ctx->m, n, ctx->tmp);
+	}
+
+	/* x - q3 m < 4 m fits in n + 1 words */
+	words_sub(x, x, n + 1, r, n + 1);
+	memset(x + n + 1, 0, (n - 1) * sizeof(limb_t));
+	while (x[n] || words_cmp(x, ctx->m, n) >= 0)
+		x[n] -= words_sub(x, x, n, ctx->m, n);
+}
+
+static void store_words(bigint_t *big, const limb_t *w, uint32_t n)
+{
+	/* big <- w[0..n) */
+	if (big->words < n)
+		bigint_duplicate_words(big, n);
+	memmove(big->bits, w, n * sizeof(limb_t));
+	big->len = n;
+	bigint_update_len(big);
+}
+
+static void load_words(limb_t *w, uint32_t n, const bigint_t *big)
+{
+	/* w[0..n) <- big zero padded, big must fit in n words */
+	memcpy(w, big->bits, big->len * sizeof(limb_t));
+	memset(w + big->len, 0, (n - big->len) * sizeof(limb_t));
+}
+
+static void barrett_store_x(bigint_barrett_t *ctx, bigint_t *big)
+{
+	store_words(big, ctx->x, ctx->n);
+}
+
+static void barrett_mul_words(bigint_barrett_t *ctx, limb_t *r,
+			      const limb_t *a, const limb_t *b)
+{
+	/* r[0..n) <- a b mod m for a, b of n words below m */
+	uint32_t n = ctx->n;
+	barrett_reserve(ctx, n, n);
+	if (a == b)
+		words_sqr(ctx->x, a, n, ctx->tmp);
+	else
+		words_mul(ctx->x, a, n, b, n, ctx->tmp);
+	barrett_reduce_x(ctx);
+	memcpy(r, ctx->x, n * sizeof(limb_t));
+}
+
+void bigint_barrett_reduce(bigint_barrett_t *ctx, bigint_t *big)
+{
+	/* Values longer than 2 n words are folded from the top, n words
+	 * at a time after the first 2 n.
+	 */
+	uint32_t n = ctx->n;
+	uint32_t len = big->len;
+	if (len < n || (len == n && words_cmp(big->bits, ctx->m, n) < 0))
+		return;
+
+	barrett_reserve(ctx, 0, 0);
+	uint32_t pos = len - MIN(len, 2 * n);
+	memcpy(ctx->x, big->bits + pos, (len - pos) * sizeof(limb_t));
+	memset(ctx->x + len - pos, 0, (2 * n - len + pos) * sizeof(limb_t));
+	barrett_reduce_x(ctx);
+	while (pos) {
+		uint32_t c = MIN(n, pos);
+		pos -= c;
+		memmove(ctx->x + c, ctx->x, n * sizeof(limb_t));
+		memcpy(ctx->x, big->bits + pos, c * sizeof(limb_t));
+		barrett_reduce_x(ctx);
+	}
+	barrett_store_x(ctx, big);
+}
+
+void bigint_barrett_mulmod(bigint_barrett_t *ctx, const bigint_t *a,
+			   const bigint_t *b, bigint_t *result)
+{
+	/* Factors of at most n words multiply straight into the context,
+	 * longer ones take the general product first.
+	 */
+	uint32_t n = ctx->n;
+	if (a->len > n || b->len > n) {
+		bigint_mul(a, b, result);
+		bigint_barrett_reduce(ctx, result);
+		return;
+	}
+	if (bigint_is_zero(a) || bigint_is_zero(b)) {
+		bigint_set_u32(result, 0);
+		return;
+	}
+
+	barrett_reserve(ctx, a->len, b->len);
+	if (a == b)
+		words_sqr(ctx->x, a->bits, a->len, ctx->tmp);
+	else
+		words_mul(ctx->x, a->bits, a->len, b->bits, b->len, ctx->tmp);
+	memset(ctx->x + a->len + b->len, 0,
+	       (2 * n - a->len - b->len) * sizeof(limb_t));
+	barrett_reduce_x(ctx);
+	barrett_store_x(ctx, result);
+}
+
+bigint_mont_t *bigint_mont_create(const bigint_t *mod)
+{
+	if (!bigint_get_lsbit(mod))
+		return NULL;
+
+	uint32_t n = mod->len;
+	bigint_mont_t *ctx = malloc(sizeof(*ctx));
+	ctx->n = n;
+	ctx->m = malloc(n * sizeof(limb_t));
+	memcpy(ctx->m, mod->bits, n * sizeof(limb_t));
+
+	limb_t inv = ctx->m[0];
+	for (int i = 0; i < BXW_2K - 1; i++)
+		inv *= 2 - ctx->m[0] * inv;
+	ctx->ninv = -inv;
+
+	bigint_t *r2 = bigint_alloc(2 * n + 2);
+	bigint_t *rem = bigint_alloc(2 * n + 2);
+	bigint_add_2k(r2, 2 * n * BITSXWORD);
+	bigint_divrem(NULL, rem, r2, mod);
+	ctx->r2 = malloc(n * sizeof(limb_t));
+	load_words(ctx->r2, n, rem);
+	bigint_destroy(r2);
+	bigint_destroy(rem);
+
+	ctx->a = malloc(n * sizeof(limb_t));
+	ctx->b = malloc(n * sizeof(limb_t));
+	ctx->t = malloc((2 * n + 2) * sizeof(limb_t));
+	ctx->tmp = NULL;
+	ctx->ntmp = 0;
+	mont_reserve(ctx);
+	return ctx;
+}
+
+void bigint_mont_destroy(bigint_mont_t *ctx)
+{
+	if (!ctx)
+		return;
+	free(ctx->m);
+	free(ctx->r2);
+	free(ctx->a);
+	free(ctx->b);
+	free(ctx->t);
+	free(ctx->tmp);
+	free(ctx);
+}
+
+static void mont_reserve(bigint_mont_t *ctx)
+{
+	/* Same as barrett_reserve, for the n by n products */
+	size_t ntmp = mul_scratch_words(ctx->n, ctx->n);
+	if (ntmp > ctx->ntmp) {
+		free(ctx->tmp);
+		ctx->tmp = malloc(ntmp * sizeof(limb_t));
+		ctx->ntmp = ntmp;
+	}
+}
+
+static void mont_reduce_words(bigint_mont_t *ctx, limb_t *r, limb_t *t)
+{
+	/* r[0..n) <- t R^-1 mod m for t < m R held in 2 n + 1 words,
+	 * t is destroyed.
+	 */
+	uint32_t n = ctx->n;
+	dlimb_t carry = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		carry += (dlimb_t) t[i + n] +
+			words_addmul_1(t + i, ctx->m, n, t[i] * ctx->ninv);
+		t[i + n] = (limb_t) carry;
+		carry >>= BITSXWORD;
+	}
+	t[2 * n] = (limb_t) carry;
+	if (t[2 * n] || words_cmp(t + n, ctx->m, n) >= 0)
+		words_sub(t + n, t + n, n, ctx->m, n);
+	memcpy(r, t + n, n * sizeof(limb_t));
+}
+
+static void mont_mul_words(bigint_mont_t *ctx, limb_t *r,
+			   const limb_t *a, const limb_t *b)
+{
+	/* r[0..n) <- a b R^-1 mod m for a, b of n words below m, r may
+	 * be a or b.
+	 */
+	uint32_t n = ctx->n;
+	limb_t *t = ctx->t;
+	if (n >= karatsuba_threshold) {
+		mont_reserve(ctx);
+		words_mul(t, a, n, b, n, ctx->tmp);
+		t[2 * n] = 0;
+		mont_reduce_words(ctx, r, t);
+		return;
+	}
+
+	/* CIOS, the running sum slides one word up per step instead of
+	 * being shifted down, it ends in t[n..2n].
+	 */
+	memset(t, 0, (2 * n + 2) * sizeof(limb_t));
+	for (uint32_t i = 0; i < n; i++) {
+		limb_t *ti = t + i;
+		dlimb_t sum = (dlimb_t) ti[n] + words_addmul_1(ti, a, n, b[i]);
+		ti[n] = (limb_t) sum;
+		ti[n + 1] = (limb_t) (sum >> BITSXWORD);
+
+		limb_t u = ti[0] * ctx->ninv;
+		sum = (dlimb_t) ti[n] + words_addmul_1(ti, ctx->m, n, u);
+		ti[n] = (limb_t) sum;
+		ti[n + 1] += (limb_t) (sum >> BITSXWORD);
+	}
+	if (t[2 * n] || words_cmp(t + n, ctx->m, n) >= 0)
+		words_sub(t + n, t + n, n, ctx->m, n);
+	memcpy(r, t + n, n * sizeof(limb_t));
+}
+
+static void mont_sqr_words(bigint_mont_t *ctx, limb_t *r,
+			   const limb_t *a)
+{
+	uint32_t n = ctx->n;
+	mont_reserve(ctx);
+	words_sqr(ctx->t, a, n, ctx->tmp);
+	ctx->t[2 * n] = 0;
+	mont_reduce_words(ctx, r, ctx->t);
+}
+
+void bigint_to_mont(bigint_mont_t *ctx, const bigint_t *big, bigint_t *result)
+{
+	/* result <- big R mod m */
+	uint32_t n = ctx->n;
+	if (big->len > n) {
+		bigint_t mod = {n, n, ctx->m, NULL, {0}};
+		bigint_t *rem = bigint_alloc(big->len + 1);
+		bigint_divrem(NULL, rem, big, &mod);
+		load_words(ctx->a, n, rem);
+		bigint_destroy(rem);
+	} else {
+		load_words(ctx->a, n, big);
+	}
+	mont_mul_words(ctx, ctx->a, ctx->a, ctx->r2);
+	store_words(result, ctx->a, n);
+}
+
+void bigint_from_mont(bigint_mont_t *ctx, const bigint_t *big,
+		      bigint_t *result)
+{
+	/* result <- big R^-1 mod m, big below m */
+	uint32_t n = ctx->n;
+	memcpy(ctx->t, big->bits, big->len * sizeof(limb_t));
+	memset(ctx->t + big->len, 0, (2 * n + 1 - big->len) * sizeof(limb_t));
+	mont_reduce_words(ctx, ctx->a, ctx->t);
+	store_words(result, ctx->a, n);
+}
+
+void bigint_mont_mul(bigint_mont_t *ctx, const bigint_t *a, const bigint_t *b,
+		     bigint_t *result)
+{
+	/* result <- a b R^-1 mod m, a and b below m */
+	load_words(ctx->a, ctx->n, a);
+	load_words(ctx->b, ctx->n, b);
+	mont_mul_words(ctx, ctx->a, ctx->a, ctx->b);
+	store_words(result, ctx->a, ctx->n);
+}
+
+void bigint_mont_sqr(bigint_mont_t *ctx, const bigint_t *a, bigint_t *result)
+{
+	/* result <- a^2 R^-1 mod m, a below m */
+	load_words(ctx->a, ctx->n, a);
+	mont_sqr_words(ctx, ctx->a, ctx->a);
+	store_words(result, ctx->a, ctx->n);
+}
+
+static uint32_t powmod_window(uint32_t bits)
+{
+	/* Sliding window width that balances the 2^(k-1) odd powers of
+	 * the table against the bits / (k + 1) products.
+	 */
+	if (bits <= 8)
+		return 1;
+	else if (bits <= 24)
+		return 2;
+	else if (bits <= 80)
+		return 3;
+	else if (bits <= 240)
+		return 4;
+	else if (bits <= 672)
+		return 5;
+	else
+		return 6;
+}
+
+void bigint_powmod(const bigint_t *base, const bigint_t *exp,
+		   const bigint_t *mod, bigint_t *result)
+{
+	/* result <- base^exp mod mod. Odd moduli work in Montgomery form,
+	 * even ones with a Barrett context.
+	 */
+	if (bigint_is_zero(mod) || bigint_compare_u32(mod, 1) == 0) {
+		/* PENDING: Set infty on zero */
+		bigint_set_u32(result, 0);
+		return;
+	} else if (bigint_is_zero(exp)) {
+		bigint_set_u32(result, 1);
+		return;
+	}
+
+	uint32_t n = mod->len;
+	bigint_mont_t *mont = bigint_mont_create(mod);
+	bigint_barrett_t *barrett = mont ? NULL : bigint_barrett_create(mod);
+	limb_t *acc = malloc(2 * n * sizeof(limb_t));
+
+	bigint_t *g = bigint_alloc(n + 1);
+	if (mont) {
+		bigint_to_mont(mont, base, g);
+	} else {
+		bigint_copy(g, base);
+		bigint_barrett_reduce(barrett, g);
+	}
+	load_words(acc + n, n, g);
+	bigint_destroy(g);
+	powmod_words(mont, barrett, acc, acc + n, exp);
+
+	if (mont) {
+		memcpy(mont->t, acc, n * sizeof(limb_t));
+		memset(mont->t + n, 0, (n + 1) * sizeof(limb_t));
+		mont_reduce_words(mont, acc, mont->t);
+	}
+	store_words(result, acc, n);
+
+	free(acc);
+	bigint_mont_destroy(mont);
+	bigint_barrett_destroy(barrett);
+}
+
+static void powmod_words(bigint_mont_t *mont, bigint_barrett_t *barrett,
+			 limb_t *acc, const limb_t *g, const bigint_t *exp)
+{
+	/* acc <- g^exp for exp > 0, in Montgomery form with mont and
+	 * reduced by barrett otherwise.
+	 */
+	uint32_t n = mont ? mont->n : barrett->n;
+
+	/* Odd powers g, g^3, ..., g^(2^k - 1) and g^2 */
+	uint32_t ebits = bigint_index_of_msbit(exp) + 1;
+	uint32_t k = powmod_window(ebits);
+	uint32_t ntab = 1U << (k - 1);
+	limb_t *tab = malloc((ntab + 1) * n * sizeof(limb_t));
+	limb_t *g2 = tab + ntab * n;
+	memcpy(tab, g, n * sizeof(limb_t));
+
+	if (ntab > 1) {
+		if (mont)
+			mont_sqr_words(mont, g2, tab);
+		else
+			barrett_mul_words(barrett, g2, tab, tab);
+	}
+	for (uint32_t i = 1; i < ntab; i++) {
+		if (mont)
+			mont_mul_words(mont, tab + i * n, tab + (i - 1) * n, g2);
+		else
+			barrett_mul_words(barrett, tab + i * n,
+					  tab + (i - 1) * n, g2);
+	}
+
+	/* Left to right, each window of up to k bits starts and ends
+	 * with a set bit, acc is one until the first window.
+	 */
+	int one = 1;
+	int64_t i = ebits - 1;
+	while (i >= 0) {
+		uint32_t w = 0;
+		int64_t l = i;
+		if ((exp->bits[i >> BXW_2K] >> (i & BXW_MOD_MASK)) & 1) {
+			l = MAX(i - (int64_t) k + 1, 0);
+			while (!((exp->bits[l >> BXW_2K] >> (l & BXW_MOD_MASK)) & 1))
+				l++;
+			for (int64_t j = i; j >= l; j--)
+				w = (w << 1) |
+					((exp->bits[j >> BXW_2K] >> (j & BXW_MOD_MASK)) & 1);
+		}
+		for (int64_t j = i; j >= l && !one; j--) {
+			if (mont)
+				mont_sqr_words(mont, acc, acc);
+			else
+				barrett_mul_words(barrett, acc, acc, acc);
+		}
+		if (w && one) {
+			memcpy(acc, tab + (w >> 1) * n, n * sizeof(limb_t));
+			one = 0;
+		} else if (w) {
+			if (mont)
+				mont_mul_words(mont, acc, acc, tab + (w >> 1) * n);
+			else
+				barrett_mul_words(barrett, acc, acc,
+						  tab + (w >> 1) * n);
+		}
+		i = l - 1;
+	}
+	free(tab);
+}
+
+void bigint_get_binary_string(const bigint_t *big, char *str)
+{
+	uint32_t i, j;
+	uint32_t len = big->len;
+	for (i = 0; i < len; i++) {
+		limb_t a = big->bits[i];
+		for (j = 0; j < BITSXWORD; j++) {
+			uint32_t idx = ((len - i) << BXW_2K) - j - 1;
+			if (a & 1)
+				str[idx] = '1';
+			else
+				str[idx] = '0';
+			a >>= 1;
+		}
+	}
+	str[len << BXW_2K] = '\0';
+}
+
+void bigint_get_hexadec_string(const bigint_t *big, char *str)
+{
+	bigint_write_hexadec_string(big, str);
+}
+
+uint32_t bigint_write_hexadec_string(const bigint_t *big, char *str)
+{
+	/* Same as bigint_get_hexadec_string, returns the number of
+	 * digits written before the terminating null.
+	 */
+	uint32_t len = big->len;
+	if (!len) {
+		strcpy(str, "0");
+		return 1;
+	}
+
+	/* The top limb without its leading zeros, then whole limbs */
+	limb_t w = big->bits[len - 1];
+	int k = index_of_msbit_in_word(w) / 4 + 1;
+	char *c = str;
+	while (k--)
+		*(c++) = hex_chars[(w >> (4 * k)) & 15];
+	c = hex_write_limbs(big->bits, len - 1, c);
+	*c = '\0';
+	return c - str;
+}
+
+static char *hex_write_limbs(const limb_t *w, uint32_t n, char *str)
+{
+	/* Writes w[n-1] down to w[0], BITSXWORD / 4 digits each, and
+	 * returns the end of the digits. On x86-64 every 64 bits are
+	 * split in nibbles in a SSE2 register, where the ones above 9
+	 * get the 7 chars between '9' and 'A' added.
+	 */
+#ifdef BIGINT_X86_64_KERNELS
+	const __m128i mask = _mm_set1_epi8(15);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i zero = _mm_set1_epi8('0');
+	const __m128i gap = _mm_set1_epi8('A' - '9' - 1);
+	while (n >= 64 / BITSXWORD) {
+		n -= 64 / BITSXWORD;
+#ifdef BIGINT_LIMB64
+		uint64_t v = w[n];
+#else
+		uint64_t v = ((uint64_t) w[n + 1] << 32) | w[n];
+#endif
+		__m128i x = _mm_cvtsi64_si128((long long) __builtin_bswap64(v));
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+		__m128i lo = _mm_and_si128(x, mask);
+		__m128i d = _mm_unpacklo_epi8(hi, lo);
+		__m128i a = _mm_and_si128(_mm_cmpgt_epi8(d, nine), gap);
+		d = _mm_add_epi8(d, _mm_add_epi8(a, zero));
+		_mm_storeu_si128((__m128i*) str, d);
+		str += 16;
+	}
+#endif
+	while (n--) {
+		for (int k = BITSXWORD / 4; k--;)
+			*(str++) = hex_chars[(w[n] >> (4 * k)) & 15];
+	}
+	return str;
+}
+
+uint32_t bigint_decimal_length_bound(const bigint_t *big)
+{
+	/* Size of the string of bigint_get_decimal_string, terminating
+	 * null included. A number of b bits has at most ceil(b log10(2))
+	 * digits and 1234 / 4096 is just above log10(2).
+	 */
+	uint64_t bits = bigint_index_of_msbit(big) + 1;
+	return (uint32_t) ((bits * 1234) >> 12) + 2;
+}
+
+void bigint_get_decimal_string(const bigint_t *big, char* str)
+{
+	if (!big->len) {
+		strcpy(str, "0");
+		return;
+	} else if (big->len < decimal_threshold) {
+		*decimal_basecase(big, str, 0) = '\0';
+		return;
+	}
+
+	/* pow[k] = 10^(d 2^k) with d digits per limb, up to the first
+	 * one whose square is above big, and the reciprocals used to
+	 * divide by them.
+	 */
+	bigint_t *pow[32];
+	bigint_t *inv[32];
+	int k = 0;
+	pow[0] = bigint_alloc(1);
+	bigint_set_u32(pow[0], 0);
+	add_limb(pow[0], DEC_LIMB_POW);
+	for (;;) {
+		inv[k] = bigint_alloc(pow[k]->len + 2);
+		bigint_recip(inv[k], pow[k]);
+		bigint_t *sqr = bigint_alloc(2 * pow[k]->len);
+		bigint_sqr(pow[k], sqr);
+		if (bigint_compare(sqr, big) > 0) {
+			bigint_destroy(sqr);
+			break;
+		}
+		pow[++k] = sqr;
+	}
+
+	*decimal_split(big, pow, inv, k, str, 0) = '\0';
+
+	for (int i = 0; i <= k; i++) {
+		bigint_destroy(pow[i]);
+		bigint_destroy(inv[i]);
+	}
+}
+
+static char *decimal_split(const bigint_t *big, bigint_t **pow,
+			   bigint_t **inv, int k, char *str, uint32_t width)
+{
+	/* Writes big < pow[k]^2 as the digits of the quotient and the
+	 * remainder by pow[k]. Pieces are padded to width digits, the
+	 * leading one (width 0) is not.
+	 */
+	if (k < 0 || big->len < decimal_threshold)
+		return decimal_basecase(big, str, width);
+	if (!width && bigint_compare(big, pow[k]) < 0)
+		return decimal_split(big, pow, inv, k - 1, str, 0);
+
+	/* Barrett's quotient floor(floor(big / 2^(L-1)) inv / 2^(L+1)),
+	 * with L the bits of pow[k], is short by at most two.
+	 */
+	uint32_t L = bigint_index_of_msbit(pow[k]) + 1;
+	bigint_t *q = bigint_alloc(big->len + 2);
+	bigint_t *r = bigint_alloc(big->len + 2);
+	bigint_copy(r, big);
+	bigint_shift_right(r, L - 1);
+	bigint_mul(r, inv[k], q);
+	bigint_shift_right(q, L + 1);
+	bigint_mul(q, pow[k], r);
+	bigint_t *rem = bigint_clone(big);
+	bigint_subtract(rem, r, NULL);
+	while (bigint_compare(rem, pow[k]) >= 0) {
+		bigint_subtract(rem, pow[k], NULL);
+		bigint_increment(q);
+	}
+	bigint_destroy(r);
+
+	uint32_t half = DEC_DIGITS_X_LIMB << k;
+	str = decimal_split(q, pow, inv, k - 1, str, width ? half : 0);
+	str = decimal_split(rem, pow, inv, k - 1, str, half);
+	bigint_destroy(q);
+	bigint_destroy(rem);
+	return str;
+}
+
+static char *decimal_basecase(const bigint_t *big, char *str, uint32_t width)
+{
+	/* Quadratic loop, divides by 10^d while writing the digits from
+	 * the right. Returns the end of the digits, without terminating
+	 * null.
+	 */
+	uint32_t n = big->len;
+	uint32_t len = width ? width : bigint_decimal_length_bound(big) - 1;
+	limb_t *w = malloc((n + 1) * sizeof(limb_t));
+	memcpy(w, big->bits, n * sizeof(limb_t));
+
+	char *c = str + len;
+	while (n) {
+		limb_t res = words_divrem_1(w, w, n, DEC_LIMB_POW);
+		if (!w[n - 1])
+			n --;
+		for (int i = 0; i < DEC_DIGITS_X_LIMB && c > str; i++) {
+			*(--c) = (char) (res % 10 + 48);
+			res /= 10;
+		}
+	}
+	while (c > str)
+		*(--c) = '0';
+	free(w);
+
+	if (!width) {
+		uint32_t zeros = 0;
+		while (zeros < len - 1 && str[zeros] == '0')
+			zeros ++;
+		memmove(str, str + zeros, len - zeros);
+		len -= zeros;
+	}
+	return str + len;
+}
+
+static void bigint_swap(bigint_t *a, bigint_t *b)
+{
+	/* The inline limbs move with the structs, so bits must point
+	 * back into its own one.
+	 */
+	bigint_t aux = *a;
+	*a = *b;
+	*b = aux;
+	if (a->bits == b->small)
+		a->bits = a->small;
+	if (b->bits == a->small)
+		b->bits = b->small;
+}
+
+static uint64_t pow_bits(const bigint_t *big, uint64_t p)
+{
+	/* Upper bound of the bits of big^p for big > 1, p > 1, saturated
+	 * above UINT32_MAX. With m the index of the top bit and t the top
+	 * 32 bits, big < (t + 1) 2^(m - 31), so log2(big) < m + log2(x)
+	 * for x = (t + 1) / 2^31 in [1, 2]. Squaring x gives the bits of
+	 * its log2, rounding up keeps the bound.
+	 */
+	uint64_t m = bigint_index_of_msbit(big);
+	if (p > UINT32_MAX || p * m > UINT32_MAX)
+		return (uint64_t) UINT32_MAX + 1;
+
+	limb_t top = big->bits[big->len - 1];
+	limb_t next = (big->len > 1) ? big->bits[big->len - 2] : 0;
+	uint32_t c = BITSXWORD - 1 - index_of_msbit_in_word(top);
+	if (c)
+		top = (top << c) | (next >> (BITSXWORD - c));
+	uint64_t t = (uint64_t) (top >> (BITSXWORD - 32));
+
+	/* x in Q30, 16 bits of log2(x) plus one unit for the rest */
+	uint64_t x = (t + 2) >> 1;
+	uint64_t frac = 1;
+	for (int i = 15; i >= 0; i--) {
+		x = (x * x + (1u << 30) - 1) >> 30;
+		if (x >> 31) {
+			frac += (uint64_t) 1 << i;
+			x = (x + 1) >> 1;
+		}
+	}
+	return p * m + ((p * frac + 0xffff) >> 16);
+}
+
+static void pow_binary(bigint_t *big, uint64_t p, bigint_t *aux,
+		       int *status)
+/* This function assumes big > 1 and p > 1 */
+{
+	/* Both big and aux hold up to the whole power, one more word
+	 * covers the len1 + len2 words that the products ask for.
+	 */
+	uint64_t bits = pow_bits(big, p);
+	if (bits > UINT32_MAX) {
+		/* The bits of the power do not fit in 32 bits */
+		set_flag_nullsafe(status, STATUS_ERROR_BAD_INPUT);
+		return;
+	}
+	uint32_t len = (uint32_t) ((bits + BITSXWORD - 1) >> BXW_2K) + 1;
+	if (aux->words < len)
+		bigint_resize_limbs(aux, len);
+	if (big->words < len)
+		bigint_resize_limbs(big, len);
+
+	/* Left to right, one square per bit and one product by the base
+	 * per set bit, big always holds the partial power.
+	 */
+	bigint_t *base = (p & (p - 1)) ? bigint_clone(big) : NULL;
+	int i = 63;
+	while (!((p >> i) & 1))
+		i--;
+	while (i--) {
+		bigint_sqr(big, aux);
+		bigint_swap(big, aux);
+		if ((p >> i) & 1) {
+			bigint_mul(big, base, aux);
+			bigint_swap(big, aux);
+		}
+	}
+	if (base)
+		bigint_destroy(base);
+}
+
+void bigint_pow(bigint_t *big, uint32_t p, bigint_t *aux)
+{
+	bigint_pow_u64(big, p, aux, NULL);
+}
+
+void bigint_pow_u64(bigint_t *big, uint64_t p, bigint_t *aux, int *status)
+{
+	/* big <- big^p, STATUS_ERROR_BAD_INPUT and big unchanged if the
+	 * bits of the power do not fit in 32 bits. Bases 0 and 1 are
+	 * their own powers.
+	 */
+	reset_flag_nullsafe(status);
+
+	if (p == 0)
+		bigint_set_u32(big, 1);
+	else if (p > 1 && bigint_compare_u32(big, 1) > 0)
+		pow_binary(big, p, aux, status);
+}
+
+#ifndef BIGINT_LIMB64
+static uint32_t sqrt_u32(uint32_t n, uint32_t *res)
+{
+	*res  = n;
+	n = 0;
+	uint32_t bit = 1;
+	bit <<= 30;
+
+	while (bit > *res)
+		bit >>= 2;
+
+	while (bit) {
+		if (*res >= n + bit) {
+			(*res) -= (n + bit);
+			n += (bit << 1);
+		}
+		n >>= 1;
+		bit >>= 2;
+	}
+	return n;
+}
+#endif
+
+static uint64_t sqrt_u64(uint64_t n, uint64_t *res)
+{
+	*res  = n;
+	n = 0;
+	uint64_t bit = 1;
+	bit <<= 62;
+
+	while (bit > *res)
+		bit >>= 2;
+
+	while (bit) {
+		if (*res >= n + bit) {
+			(*res) -= (n + bit);
+			n += (bit << 1);
+		}
+		n >>= 1;
+		bit >>= 2;
+	}
+	return n;
+}
+
+static void sqrt_rem(bigint_t *s, bigint_t *r, const bigint_t *a)
+{
+	/* s <- floor(sqrt(a)) and r <- a - s^2, with s, r and a three
+	 * different bigints. Zimmermann's Karatsuba square root: the
+	 * root s' of the top half of a gives the top half of s and one
+	 * division by 2 s' the bottom one.
+	 */
+	uint32_t n = bigint_index_of_msbit(a) + 1;
+	if (n <= 64) {
+		uint64_t rem;
+		bigint_set_u64(s, sqrt_u64(bigint_truncate_u64(a), &rem));
+		bigint_set_u64(r, rem);
+		return;
+	}
+
+	/* a 2^(2t) = a3 2^(3k) + a2 2^(2k) + a1 2^k + a0 with 4k - 1
+	 * or 4k bits, so a3 2^k + a2 is at least 2^(2k - 2).
+	 */
+	uint32_t t = (n % 4 == 1 || n % 4 == 2);
+	uint32_t k = (n + 2 * t + 1) / 4;
+	bigint_t *at = bigint_alloc(a->len + 1);
+	bigint_t *u = bigint_alloc(a->len + 2);
+	bigint_t *d = bigint_alloc(a->len + 2);
+	bigint_copy(at, a);
+	bigint_shift_left(at, 2 * t);
+	bigint_copy(u, at);
+	bigint_shift_right(u, 2 * k);
+	sqrt_rem(s, r, u);
+
+	/* (q, u) <- divrem(r' 2^k + a1, 2 s') */
+	bigint_copy(u, at);
+	bigint_shift_right(u, k);
+	bigint_mod_2k(u, k);
+	bigint_shift_left(r, k);
+	bigint_add(r, u);
+	bigint_copy(d, s);
+	bigint_shift_left(d, 1);
+	bigint_div(r, d, u);
+
+	/* s <- s' 2^k + q and r <- u 2^k + a0 - q^2, one less and
+	 * r + 2 s - 1 if that is negative.
+	 */
+	bigint_shift_left(s, k);
+	bigint_add(s, r);
+	bigint_sqr(r, d);
+	bigint_mod_2k(at, k);
+	bigint_shift_left(u, k);
+	bigint_add(u, at);
+	if (bigint_compare(u, d) < 0) {
+		bigint_add(u, s);
+		bigint_add(u, s);
+		bigint_decrement(u);
+		bigint_decrement(s);
+	}
+	bigint_subtract(u, d, NULL);
+	bigint_copy(r, u);
+
+	/* With s = 2 s0 + b the root of a is s0 and its remainder
+	 * s0 b + (r + b) / 4.
+	 */
+	if (t) {
+		int b = bigint_get_lsbit(s);
+		bigint_shift_right(s, 1);
+		if (b)
+			bigint_increment(r);
+		bigint_shift_right(r, 2);
+		if (b)
+			bigint_add(r, s);
+	}
+	bigint_destroy(at);
+	bigint_destroy(u);
+	bigint_destroy(d);
+}
+
+void bigint_sqrt(bigint_t *big, bigint_t *res)
+{
+#ifdef BIGINT_LIMB64
+	if (big->len < 2) {
+		uint64_t a = bigint_truncate_u64(big);
+		uint64_t r;
+		a = sqrt_u64(a, &r);
+		bigint_set_u64(big, a);
+		bigint_set_u64(res, r);
+	} else {
+		bigint_t *a = bigint_clone(big);
+		sqrt_rem(big, res, a);
+		bigint_destroy(a);
+	}
+#else
+	if (big->len < 2) {		
+		uint32_t a = bigint_truncate_u32(big);
+		uint32_t r;
+		a = sqrt_u32(a, &r);
+		bigint_set_u32(big, a);
+		bigint_set_u32(res, r);
+	} else if (big->len == 2) {
+		uint64_t a = bigint_truncate_u64(big);
+		uint64_t r;
+		a = sqrt_u64(a, &r);
+		bigint_set_u64(big, a);
+		bigint_set_u64(res, r);
+	} else {
+		bigint_t *a = bigint_clone(big);
+		sqrt_rem(big, res, a);
+		bigint_destroy(a);
+	}
+#endif
+}
+
+void bigint_root(bigint_t *big, uint32_t k, bigint_t *rem, int *status)
+{
+	/* big <- floor(big^(1/k)) and rem <- big - root^k. Newton's
+	 * iteration x <- ((k - 1) x + big / x^(k - 1)) / k decreases from
+	 * 2^ceil(bits / k) down to the root. STATUS_ERROR_BAD_INPUT, big
+	 * unchanged and rem zero for k = 0.
+	 */
+	reset_flag_nullsafe(status);
+
+	if (k == 0) {
+		set_flag_nullsafe(status, STATUS_ERROR_BAD_INPUT);
+		bigint_set_u32(rem, 0);
+		return;
+	} else if (k == 1 || bigint_compare_u32(big, 1) <= 0) {
+		bigint_set_u32(rem, 0);
+		return;
+	} else if (k == 2) {
+		bigint_sqrt(big, rem);
+		return;
+	}
+
+	uint32_t bits = bigint_index_of_msbit(big) + 1;
+	uint32_t len = big->len + 1;
+	bigint_t *x = bigint_alloc(len);
+	bigint_t *y = bigint_alloc(len);
+	bigint_t *p = bigint_alloc(len);
+	bigint_t *aux = bigint_alloc(len);
+	uint32_t res;
+	bigint_add_2k(x, (bits + k - 1) / k);
+	while (1) {
+		bigint_copy(p, x);
+		bigint_pow(p, k - 1, aux);
+		bigint_copy(y, big);
+		bigint_div(y, p, aux);
+		bigint_mul_u32(x, k - 1, p);
+		bigint_add(y, p);
+		bigint_div_u32(y, k, &res);
+		if (bigint_compare(y, x) >= 0)
+			break;
+		bigint_swap(x, y);
+	}
+
+	bigint_copy(p, x);
+	bigint_pow(p, k, aux);
+	bigint_copy(rem, big);
+	bigint_subtract(rem, p, NULL);
+	bigint_copy(big, x);
+	bigint_destroy(x);
+	bigint_destroy(y);
+	bigint_destroy(p);
+	bigint_destroy(aux);
+}
+
+int bigint_is_perfect_square(const bigint_t *big)
+{
+	/* Squares modulo 64, 63, 11, 13 and 17 reject most non squares
+	 * before the root is taken, about 1 in 600 gets through.
+	 */
+	static const uint64_t sq64 = 0x202021202030213ULL;
+	static const uint64_t sq63 = 0x402483012450293ULL;
+	static const uint32_t sq11 = 0x23B;
+	static const uint32_t sq13 = 0x161B;
+	static const uint32_t sq17 = 0x1A317;
+	if (!big->len)
+		return 1;
+	if (!((sq64 >> (big->bits[0] & 63)) & 1))
+		return 0;
+	limb_t m = words_divrem_1(NULL, big->bits, big->len, 63 * 11 * 13 * 17);
+	if (!((sq63 >> (m % 63)) & 1) || !((sq11 >> (m % 11)) & 1) ||
+	    !((sq13 >> (m % 13)) & 1) || !((sq17 >> (m % 17)) & 1))
+		return 0;
+
+	bigint_t *s = bigint_clone(big);
+	bigint_t *r = bigint_alloc(big->len);
+	bigint_sqrt(s, r);
+	int is_square = bigint_is_zero(r);
+	bigint_destroy(s);
+	bigint_destroy(r);
+	return is_square;
+}
+
+void bigint_gcd(const bigint_t *a, const bigint_t *b, bigint_t *result)
+{
+	/* result <- gcd(a, b), 64 bits operands run the binary algorithm
+	 * and longer ones gcd_half.
+	 */
+	int swap = bigint_compare(a, b) < 0;
+	bigint_t *x = bigint_clone(swap ? b : a);
+	bigint_t *y = bigint_clone(swap ? a : b);
+	if (x->len <= 64 / BITSXWORD)
+		bigint_set_u64(x, gcd_u64(bigint_truncate_u64(x),
+					  bigint_truncate_u64(y)));
+	else
+		gcd_half(x, y, 0, NULL);
+	bigint_copy(result, x);
+	bigint_destroy(x);
+	bigint_destroy(y);
+}
+
+int bigint_gcdext(const bigint_t *a, const bigint_t *b, bigint_t *g,
+		  bigint_t *s, bigint_t *t)
+{
+	/* g <- gcd(a, b) with g = a s - b t when it returns 0 and
+	 * g = b t - a s when it returns 1, s <= b / g and t <= a / g.
+	 * s and t may be NULL.
+	 */
+	int swap = bigint_compare(a, b) < 0;
+	bigint_t *x = bigint_clone(swap ? b : a);
+	bigint_t *y = bigint_clone(swap ? a : b);
+	gcd_matrix_t m;
+	gcd_matrix_init(&m, 1);
+	gcd_half(x, y, 0, &m);
+
+	/* (a; b) = m (g; 0) so g = det (m3 a - m1 b) */
+	bigint_copy(g, x);
+	if (s)
+		bigint_copy(s, m.m[swap ? 1 : 3]);
+	if (t)
+		bigint_copy(t, m.m[swap ? 3 : 1]);
+	int neg = m.neg ^ swap;
+	gcd_matrix_free(&m);
+	bigint_destroy(x);
+	bigint_destroy(y);
+	return neg;
+}
+
+void bigint_modinv(const bigint_t *a, const bigint_t *mod, bigint_t *result,
+		   int *status)
+{
+	/* result <- a^-1 mod mod, STATUS_ERROR_BAD_INPUT and zero if a
+	 * and mod are not coprime.
+	 */
+	reset_flag_nullsafe(status);
+	if (bigint_is_zero(mod)) {
+		bigint_set_u32(result, 0);
+		set_flag_nullsafe(status, STATUS_ERROR_BAD_INPUT);
+		return;
+	}
+
+	bigint_t *q = bigint_clone(a);
+	bigint_t *r = bigint_alloc(mod->len + 1);
+	bigint_t *g = bigint_alloc(mod->len + 1);
+	bigint_div(q, mod, r);
+	int neg = bigint_gcdext(r, mod, g, result, NULL);
+	if (bigint_compare_u32(g, 1)) {
+		bigint_set_u32(result, 0);
+		set_flag_nullsafe(status, STATUS_ERROR_BAD_INPUT);
+	} else if (neg && !bigint_is_zero(result)) {
+		/* a s = -1 mod mod */
+		bigint_copy(r, result);
+		bigint_copy(result, mod);
+		bigint_subtract(result, r, NULL);
+	}
+	bigint_destroy(q);
+	bigint_destroy(r);
+	bigint_destroy(g);
+}
+
+static uint64_t gcd_u64(uint64_t a, uint64_t b)
+{
+	/* Binary gcd, odd a and b are subtracted and stripped of the
+	 * trailing zeros of the difference.
+	 */
+	if (!a || !b)
+		return a | b;
+	uint32_t k = 0;
+	while (!((a | b) & 1)) {
+		a >>= 1;
+		b >>= 1;
+		k ++;
+	}
+	while (!(a & 1))
+		a >>= 1;
+	do {
+		while (!(b & 1))
+			b >>= 1;
+		if (a > b) {
+			uint64_t t = a;
+			a = b;
+			b = t;
+		}
+		b -= a;
+	} while (b);
+	return a << k;
+}
+
+static dlimb_t gcd_top(const bigint_t *big, uint32_t h)
+{
+	/* floor(big / 2^h), which must fit in two words */
+	uint32_t i = h >> BXW_2K;
+	uint32_t sh = h & BXW_MOD_MASK;
+	limb_t w0 = i < big->len ? big->bits[i] : 0;
+	limb_t w1 = i + 1 < big->len ? big->bits[i + 1] : 0;
+	limb_t w2 = i + 2 < big->len ? big->bits[i + 2] : 0;
+	dlimb_t x = ((dlimb_t) w1 << BITSXWORD) | w0;
+	if (sh)
+		x = (x >> sh) | ((dlimb_t) w2 << (2 * BITSXWORD - sh));
+	return x;
+}
+
+static uint32_t gcd_lehmer_q(const bigint_t *a, const bigint_t *b,
+			     uint32_t s, limb_t *x)
+{
+	/* Lehmer's step for a >= b > 0: the quotients of the top two
+	 * words of a and b that Jebelean's condition proves right for
+	 * a and b, while the remainders keep over s bits. x <- the
+	 * product (x0 x1; x2 x3) of their matrices (q 1; 1 0), returns
+	 * the number of quotients.
+	 */
+	uint32_t n = bigint_index_of_msbit(a) + 1;
+	uint32_t h = n > 2 * BITSXWORD ? n - 2 * BITSXWORD : 0;
+	if (s >= h + 2 * BITSXWORD)
+		return 0;
+	dlimb_t min = s > h ? (dlimb_t) 1 << (s - h) : 0;
+	dlimb_t ah = gcd_top(a, h);
+	dlimb_t bh = gcd_top(b, h);
+
+	/* x1 and x0 are |v_k| and |v_k+1|, the cofactors of b in the
+	 * remainders ah and bh. The next remainder r is right if
+	 * r >= |v_k+2| and bh - r >= |v_k+2 - v_k+1|.
+	 */
+	limb_t x0 = 1, x1 = 0, x2 = 0, x3 = 1;
+	uint32_t k = 0;
+	while (bh) {
+		dlimb_t q = ah / bh;
+		dlimb_t r = ah - q * bh;
+		if (q > NMAX)
+			break;
+		dlimb_t y0 = q * x0 + x1;
+		if (y0 > NMAX || r < y0 || bh - r < y0 + x0 || r < min)
+			break;
+		limb_t y2 = (limb_t) q * x2 + x3;
+		x1 = x0;
+		x0 = (limb_t) y0;
+		x3 = x2;
+		x2 = y2;
+		ah = bh;
+		bh = r;
+		k ++;
+	}
+	x[0] = x0;
+	x[1] = x1;
+	x[2] = x2;
+	x[3] = x3;
+	return k;
+}
+
+static limb_t gcd_combine(bigint_t *r, const bigint_t *a, limb_t x,
+			  const bigint_t *b, limb_t y, int sub)
+{
+	/* r <- x a + y b, or x a - y b when sub, returns the borrow of
+	 * the subtraction. r must be another bigint than a and b.
+	 */
+	uint32_t n = MAX(a->len, b->len) + 2;
+	if (r->words < n)
+		bigint_duplicate_words(r, n);
+	memset(r->bits, 0, n * sizeof(limb_t));
+	r->bits[a->len] = words_addmul_1(r->bits, a->bits, a->len, x);
+	limb_t c;
+	if (sub) {
+		c = words_submul_1(r->bits, b->bits, b->len, y);
+		c = words_sub_1(r->bits + b->len, r->bits + b->len,
+				n - b->len, c);
+	} else {
+		c = words_addmul_1(r->bits, b->bits, b->len, y);
+		words_add_1(r->bits + b->len, r->bits + b->len,
+			    n - b->len, c);
+		c = 0;
+	}
+	r->len = n;
+	bigint_update_len(r);
+	return c;
+}
+
+static int gcd_apply(bigint_t *a, bigint_t *b, const limb_t *x, int neg,
+		     bigint_t **t)
+{
+	/* (a; b) <- x^-1 (a; b), that is (x3 a - x1 b; x0 b - x2 a)
+	 * times the determinant. Returns 0 and leaves them if that is
+	 * not a > b >= 0.
+	 */
+	limb_t c;
+	if (neg) {
+		c = gcd_combine(t[0], b, x[1], a, x[3], 1);
+		c |= gcd_combine(t[1], a, x[2], b, x[0], 1);
+	} else {
+		c = gcd_combine(t[0], a, x[3], b, x[1], 1);
+		c |= gcd_combine(t[1], b, x[0], a, x[2], 1);
+	}
+	if (c || bigint_compare(t[0], t[1]) <= 0)
+		return 0;
+	bigint_swap(a, t[0]);
+	bigint_swap(b, t[1]);
+	return 1;
+}
+
+static int gcd_apply_matrix(bigint_t *a, bigint_t *b, const gcd_matrix_t *q,
+			    bigint_t **t)
+{
+	/* Same as gcd_apply for a matrix of bigints */
+	bigint_t *p0 = t[0], *p1 = t[1], *p2 = t[2];
+	bigint_mul(q->m[3], a, p0);
+	bigint_mul(q->m[1], b, p1);
+	if (q->neg) {
+		p0 = t[1];
+		p1 = t[0];
+	}
+	if (bigint_compare(p0, p1) < 0)
+		return 0;
+	bigint_subtract(p0, p1, NULL);
+
+	bigint_t *p3 = p1;
+	bigint_mul(q->m[0], b, p3);
+	bigint_mul(q->m[2], a, p2);
+	if (q->neg) {
+		p3 = t[2];
+		p2 = p1;
+	}
+	if (bigint_compare(p3, p2) < 0)
+		return 0;
+	bigint_subtract(p3, p2, NULL);
+	if (bigint_compare(p0, p3) <= 0)
+		return 0;
+	bigint_swap(a, p0);
+	bigint_swap(b, p3);
+	return 1;
+}
+
+static void gcd_matrix_init(gcd_matrix_t *m, uint32_t limbs)
+{
+	/* m <- identity */
+	for (int i = 0; i < 4; i++)
+		m->m[i] = bigint_alloc(limbs);
+	bigint_set_u32(m->m[0], 1);
+	bigint_set_u32(m->m[3], 1);
+	m->neg = 0;
+}
+
+static void gcd_matrix_free(gcd_matrix_t *m)
+{
+	for (int i = 0; i < 4; i++)
+		bigint_destroy(m->m[i]);
+}
+
+static void gcd_matrix_mul_q(gcd_matrix_t *m, const limb_t *x, int neg,
+			     bigint_t **t)
+{
+	/* m <- m x */
+	for (int i = 0; i < 4; i += 2) {
+		gcd_combine(t[0], m->m[i], x[0], m->m[i + 1], x[2], 0);
+		gcd_combine(t[1], m->m[i], x[1], m->m[i + 1], x[3], 0);
+		bigint_swap(m->m[i], t[0]);
+		bigint_swap(m->m[i + 1], t[1]);
+	}
+	m->neg ^= neg;
+}
+
+static void gcd_matrix_mul_div(gcd_matrix_t *m, const bigint_t *q,
+			       bigint_t *t)
+{
+	/* m <- m (q 1; 1 0) */
+	for (int i = 0; i < 4; i += 2) {
+		bigint_mul(m->m[i], q, t);
+		bigint_add(t, m->m[i + 1]);
+		bigint_swap(m->m[i + 1], m->m[i]);
+		bigint_swap(m->m[i], t);
+	}
+	m->neg ^= 1;
+}
+
+static void gcd_matrix_mul(gcd_matrix_t *m, const gcd_matrix_t *q,
+			   bigint_t **t)
+{
+	/* m <- m q */
+	for (int i = 0; i < 4; i += 2) {
+		bigint_t *a = m->m[i], *b = m->m[i + 1];
+		bigint_mul(a, q->m[0], t[0]);
+		bigint_mul(b, q->m[2], t[1]);
+		bigint_add(t[0], t[1]);
+		bigint_mul(a, q->m[1], t[1]);
+		bigint_mul(b, q->m[3], a);
+		bigint_add(a, t[1]);
+		bigint_swap(a, b);
+		bigint_swap(a, t[0]);
+	}
+	m->neg ^= q->neg;
+}
+
+static void gcd_half(bigint_t *a, bigint_t *b, uint32_t s, gcd_matrix_t *m)
+{
+	/* Quotient steps on a >= b while b keeps over s bits, m <- m
+	 * times their matrices when it is not NULL. To take d = n - s
+	 * bits off a of n bits, the quotients that half the top
+	 * MIN(2 d, n / 2) bits come from a recursive call. They are
+	 * checked on a and b, a Lehmer step follows when they fail.
+	 */
+	bigint_t *t[3];
+	for (int i = 0; i < 3; i++)
+		t[i] = bigint_alloc(a->len + 2);
+	limb_t x[4];
+	while (!bigint_is_zero(b) && bigint_index_of_msbit(b) >= s) {
+		uint32_t n = bigint_index_of_msbit(a) + 1;
+		uint32_t n1 = MIN(2 * (n - s), n / 2);
+		if (n1 >= (hgcd_threshold << BXW_2K)) {
+			uint32_t p = n - n1;
+			bigint_t *a1 = bigint_clone(a);
+			bigint_t *b1 = bigint_clone(b);
+			gcd_matrix_t q;
+			bigint_shift_right(a1, p);
+			bigint_shift_right(b1, p);
+			gcd_matrix_init(&q, 1);
+			gcd_half(a1, b1, n1 / 2 + BITSXWORD, &q);
+			int ok = !bigint_is_zero(q.m[1]) &&
+				gcd_apply_matrix(a, b, &q, t);
+			if (ok && m)
+				gcd_matrix_mul(m, &q, t);
+			gcd_matrix_free(&q);
+			bigint_destroy(a1);
+			bigint_destroy(b1);
+			if (ok)
+				continue;
+		}
+
+		uint32_t k = gcd_lehmer_q(a, b, s, x);
+		if (k && gcd_apply(a, b, x, k & 1, t)) {
+			if (m)
+				gcd_matrix_mul_q(m, x, k & 1, t);
+			continue;
+		}
+
+		/* One division, unless the remainder gets too short */
+		bigint_copy(t[0], a);
+		bigint_div(t[0], b, t[1]);
+		if (s && (bigint_is_zero(t[1]) ||
+			  bigint_index_of_msbit(t[1]) < s))
+			break;
+		bigint_swap(a, b);
+		bigint_swap(b, t[1]);
+		if (m)
+			gcd_matrix_mul_div(m, t[0], t[2]);
+	}
+	for (int i = 0; i < 3; i++)
+		bigint_destroy(t[i]);
+}
+
+int bigint_is_probable_prime(const bigint_t *big, uint32_t rounds)
+{
+	/* 1 if big passes trial division and rounds of Miller-Rabin, a
+	 * composite passes with probability below 4^-rounds. The answer
+	 * is exact below 2^64.
+	 */
+	small_primes_init();
+	if (bigint_index_of_msbit(big) < 16) {
+		uint32_t n = bigint_truncate_u32(big);
+		uint32_t lo = 0, hi = SMALL_PRIMES;
+		while (lo < hi) {
+			uint32_t mid = (lo + hi) / 2;
+			if (small_primes[mid] < n)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo < SMALL_PRIMES && small_primes[lo] == n;
+	}
+
+	/* Trial division by 4 primes per bit, up to those below 2^16 */
+	uint32_t bits = bigint_index_of_msbit(big) + 1;
+	uint32_t np = MIN(SMALL_PRIMES, 4 * bits);
+	if (small_primes_divide(big, np))
+		return 0;
+	return miller_rabin(big, MAX(rounds, 1));
+}
+
+void bigint_get_prime(bigint_t *big, uint32_t nbits, bigint_rng_t rng)
+{
+	/* big <- a random prime of nbits bits. A random odd x is sieved
+	 * by the small primes over x, x + 2, ... x + 2 (W - 1), the
+	 * residues of x move by 2 W to the next window. rng NULL draws
+	 * from rand(), which is not fit for key material.
+	 */
+	if (nbits < 2) {
+		/* PENDING: Set infty */
+		bigint_set_u32(big, 0);
+		return;
+	}
+	small_primes_init();
+	if (!rng)
+		rng = rng_default;
+
+	uint32_t n = (nbits + BITSXWORD - 1) >> BXW_2K;
+	uint32_t rounds = prime_rounds(nbits);
+	uint32_t *res = malloc(SMALL_PRIMES * sizeof(uint32_t));
+	uint8_t *sieve = malloc(BIGINT_PRIME_SIEVE);
+	bigint_t *x = bigint_alloc(n + 1);
+	for (;;) {
+		/* x <- random of nbits bits, top and bottom bits on */
+		for (uint32_t i = 0; i < n; i++) {
+			uint64_t r = rng();
+#ifdef BIGINT_LIMB64
+			x->bits[i] = r;
+#else
+			x->bits[i] = (limb_t) (r ^ (r >> 32));
+#endif
+		}
+		x->len = n;
+		if (nbits & BXW_MOD_MASK)
+			x->bits[n - 1] &= ((limb_t) 1 << (nbits & BXW_MOD_MASK)) - 1;
+		x->bits[(nbits - 1) >> BXW_2K] |=
+			(limb_t) 1 << ((nbits - 1) & BXW_MOD_MASK);
+		x->bits[0] |= 1;
+		bigint_update_len(x);
+		if (nbits <= 16) {
+			if (bigint_is_probable_prime(x, 1))
+				break;
+			continue;
+		}
+
+		/* Candidates x + 2 i still hold nbits bits */
+		small_primes_mod(x, SMALL_PRIMES, res);
+		int found = 0;
+		while (!found && bigint_index_of_msbit(x) == nbits - 1) {
+			memset(sieve, 0, BIGINT_PRIME_SIEVE);
+			for (uint32_t j = 1; j < SMALL_PRIMES; j++) {
+				/* x + 2 i = 0 mod p for i = -x / 2 mod p */
+				uint32_t p = small_primes[j];
+				uint32_t i = (uint32_t) ((uint64_t) (p - res[j]) *
+							 ((p + 1) / 2) % p);
+				for (; i < BIGINT_PRIME_SIEVE; i += p)
+					sieve[i] = 1;
+			}
+
+			uint32_t i0 = 0;
+			for (uint32_t i = 0; i < BIGINT_PRIME_SIEVE; i++) {
+				if (sieve[i])
+					continue;
+				bigint_add_u32(x, 2 * (i - i0));
+				i0 = i;
+				if (bigint_index_of_msbit(x) != nbits - 1)
+					break;
+				if (miller_rabin(x, rounds)) {
+					found = 1;
+					break;
 				}
-				bigint_update_len(big);
 			}
+			if (found || bigint_index_of_msbit(x) != nbits - 1)
+				break;
+			bigint_add_u32(x, 2 * (BIGINT_PRIME_SIEVE - i0));
+			for (uint32_t j = 1; j < SMALL_PRIMES; j++)
+				res[j] = (res[j] + 2 * BIGINT_PRIME_SIEVE) %
+					small_primes[j];
 		}
+		if (found)
+			break;
 	}
+	bigint_copy(big, x);
+	bigint_destroy(x);
+	free(res);
+	free(sieve);
 }
 
-void bigint_div_2kless1(bigint_t *big, uint32_t k, bigint_t *res)
+static void small_primes_init(void)
 {
-	bigint_copy(res, big);
-	bigint_set_u32(big, 0);
-	
-	while (bigint_compare_2k(res, k) >= 0) {
-		add_N_div2k(big, res, k);
-		set_div2k_plus_res2k(res, k);
+	/* Sieve of Eratosthenes below 2^16, once */
+	static int done;
+	if (done)
+		return;
+	uint8_t *comp = calloc(1 << 16, 1);
+	uint32_t np = 0;
+	for (uint32_t i = 2; i < (1 << 16); i++) {
+		if (comp[i])
+			continue;
+		small_primes[np++] = (uint16_t) i;
+		for (uint32_t j = i * i; j < (1 << 16); j += i)
+			comp[j] = 1;
+	}
+	free(comp);
+	done = 1;
+}
+
+static uint32_t small_primes_group(uint32_t i, uint32_t np, limb_t *prod)
+{
+	/* prod <- p_i p_i+1 ... p_j-1 as many as fit in a limb, returns j */
+	limb_t m = small_primes[i++];
+	while (i < np && m <= NMAX / small_primes[i])
+		m *= small_primes[i++];
+	*prod = m;
+	return i;
+}
+
+static int small_primes_divide(const bigint_t *big, uint32_t np)
+{
+	/* 1 if one of the first np primes divides big, one remainder of
+	 * words_divrem_1 per limb sized product of them.
+	 */
+	for (uint32_t i = 0; i < np;) {
+		limb_t prod;
+		uint32_t j = small_primes_group(i, np, &prod);
+		limb_t r = words_divrem_1(NULL, big->bits, big->len, prod);
+		for (; i < j; i++) {
+			if (r % small_primes[i] == 0)
+				return 1;
+		}
 	}
+	return 0;
+}
 
-	if (bigint_compare_2kless1(res, k) >= 0) {
-		bigint_add_u32(big, 1);
-		bigint_add_u32(res, 1);
-		bigint_subtract_2k(res, k, NULL);
+static void small_primes_mod(const bigint_t *big, uint32_t np, uint32_t *res)
+{
+	/* res[i] <- big mod p_i for the first np primes */
+	for (uint32_t i = 0; i < np;) {
+		limb_t prod;
+		uint32_t j = small_primes_group(i, np, &prod);
+		limb_t r = words_divrem_1(NULL, big->bits, big->len, prod);
+		for (; i < j; i++)
+			res[i] = (uint32_t) (r % small_primes[i]);
 	}
 }
 
-static void add_N_mul2k(bigint_t *big, const bigint_t *add, uint32_t k)
+static int miller_rabin(const bigint_t *big, uint32_t rounds)
 {
-	/* Return big + adding * 2k */
-	uint32_t iword = k >> BXW_2K;
-	uint32_t ibit = k & BXW_MOD_MASK;
-	uint32_t cbit = BITSXWORD - ibit;
-        
-	uint32_t len = MAX(big->len, add->len + iword + (ibit?1:0));
-	if (len > big->words)
-		bigint_duplicate_words(big, len);
+	/* Miller-Rabin for odd big > 3 on Montgomery powmod. Below 2^64
+	 * the bases 2, 3, ..., 37 decide it, above the first base is 2
+	 * and the next are 64 bits drawn from a generator seeded by big.
+	 */
+	uint32_t n = big->len;
+	int small = bigint_index_of_msbit(big) < 64;
+	if (small)
+		rounds = 12;
 
-	uint32_t i;
-	uint64_t sum = 0;
-	for (i = 0; i < len; i++) {
-		uint32_t j = i + iword;
-		if (i <= add->len) {
-			uint32_t adding = 0;
-			if (i < add->len)
-				adding |= (add->bits[i] << ibit);
-			if (i && ibit)
-				adding |= (add->bits[i - 1] >> cbit);
-			
-			sum += (uint64_t) big->bits[j] + adding;
+	/* big - 1 = d 2^s with d odd */
+	bigint_t *d = bigint_clone(big);
+	bigint_decrement(d);
+	uint32_t s = bigint_get_right_most_on_bit(d);
+	bigint_t *a = bigint_alloc(n + 1);
+	bigint_mont_t *mont = bigint_mont_create(big);
+	limb_t *one = malloc(4 * n * sizeof(limb_t));
+	limb_t *mone = one + n;
+	limb_t *g = mone + n;
+	limb_t *acc = g + n;
+	bigint_to_mont(mont, d, a);
+	load_words(mone, n, a);
+	bigint_set_u32(a, 1);
+	bigint_to_mont(mont, a, a);
+	load_words(one, n, a);
+	bigint_shift_right(d, s);
+
+	uint64_t seed = ((uint64_t) big->bits[n - 1] << 32) ^ big->bits[0] ^ n;
+	int prime = 1;
+	for (uint32_t r = 0; r < rounds && prime; r++) {
+		if (small || !r) {
+			bigint_set_u32(a, small_primes[r]);
 		} else {
-			if (!sum)
+			/* splitmix64 */
+			uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			bigint_set_u64(a, (z ^ (z >> 31)) | 2);
+		}
+		bigint_to_mont(mont, a, a);
+		load_words(g, n, a);
+		powmod_words(mont, NULL, acc, g, d);
+
+		/* a^d = 1 or a^(d 2^i) = -1 for some i < s */
+		size_t size = n * sizeof(limb_t);
+		if (!memcmp(acc, one, size) || !memcmp(acc, mone, size))
+			continue;
+		prime = 0;
+		for (uint32_t i = 1; i < s; i++) {
+			mont_sqr_words(mont, acc, acc);
+			if (!memcmp(acc, mone, size)) {
+				prime = 1;
+				break;
+			}
+			if (!memcmp(acc, one, size))
 				break;
-			sum += (uint64_t) big->bits[j];
 		}
-		big->bits[j] = (uint32_t) sum;
-		sum >>= BITSXWORD;
-	}
-	if (sum) {
-		big->bits[len] = sum;
-		len ++;
 	}
-	big->len = len;
+	free(one);
+	bigint_mont_destroy(mont);
+	bigint_destroy(a);
+	bigint_destroy(d);
+	return prime;
 }
 
-static void add_N_div2k(bigint_t *big, const bigint_t *add, uint32_t k)
+static uint32_t prime_rounds(uint32_t bits)
 {
-	/* Return big + adding / 2k */
-	uint32_t iword = k >> BXW_2K;
-	if (iword >= add->len)
-		return;
-	
-	uint32_t ibit = k & BXW_MOD_MASK;
-	uint32_t cbit = BITSXWORD - ibit;
-        
-	uint32_t len = MAX(big->len, add->len - iword);
-	if (len > big->words)
-		bigint_duplicate_words(big, len);
+	/* Rounds for error below 2^-80 on random candidates, table 4.4
+	 * of the Handbook of Applied Cryptography.
+	 */
+	static const uint16_t table[][2] = {
+		{1300, 2}, {850, 3}, {650, 4}, {550, 5}, {450, 6}, {400, 7},
+		{350, 8}, {300, 9}, {250, 12}, {200, 15}, {150, 18}, {0, 27}
+	};
+	int i = 0;
+	while (bits < table[i][0])
+		i++;
+	return table[i][1];
+}
 
-	uint32_t i;
-	uint64_t sum = 0;
-	for (i = 0; i < len; i++) {
-		uint32_t j = i + iword;
-		if (j < add->len) {
-			uint32_t adding = (add->bits[j] >> ibit);
-			if (j + 1 < add->len && ibit) {
-				adding |= (add->bits[j + 1] << cbit);
+static uint64_t rng_default(void)
+{
+	/* 64 bits out of the 31 of three rand() */
+	return ((uint64_t) rand() << 33) ^ ((uint64_t) rand() << 13) ^
+		(uint64_t) rand();
+}
+
+static uint32_t *primes_upto(uint32_t n, uint32_t *np)
+{
+	/* Primes up to n, sieve of Eratosthenes over the odd numbers,
+	 * comp[i] tells if 2 i + 1 is composite.
+	 */
+	uint32_t h = n / 2;
+	uint8_t *comp = calloc(h + 1, 1);
+	for (uint64_t i = 1; (2 * i + 1) * (2 * i + 1) <= n; i++) {
+		if (comp[i])
+			continue;
+		for (uint64_t j = (2 * i + 1) * (2 * i + 1) / 2; j <= h;
+		     j += 2 * i + 1)
+			comp[j] = 1;
+	}
+	uint32_t count = (n >= 2);
+	for (uint32_t i = 1; i <= h && 2 * i + 1 <= n; i++)
+		count += !comp[i];
+	uint32_t *primes = malloc(MAX(count, 1) * sizeof(uint32_t));
+	*np = 0;
+	if (n >= 2)
+		primes[(*np)++] = 2;
+	for (uint32_t i = 1; i <= h && 2 * i + 1 <= n; i++)
+		if (!comp[i])
+			primes[(*np)++] = 2 * i + 1;
+	free(comp);
+	return primes;
+}
+
+static void prod_leaf_u32(const uint32_t *u, uint32_t n, bigint_t *result)
+{
+	/* Factors gather in a limb while they fit, each full limb then
+	 * multiplies the partial product, which takes a limb more at
+	 * most.
+	 */
+	limb_t *r = malloc(2 * (n + 3) * sizeof(limb_t));
+	limb_t *t = r + n + 3;
+	uint32_t len = 1;
+	limb_t acc = 1;
+	r[0] = 1;
+	for (uint32_t i = 0; i <= n; i++) {
+		if (i < n) {
+			dlimb_t m = (dlimb_t) acc * u[i];
+			if (!(m >> BITSXWORD)) {
+				acc = (limb_t) m;
+				continue;
 			}
-			sum += (uint64_t) big->bits[i] + adding;
-		} else {
-			if (!sum)
-				break;
-			sum += (uint64_t) big->bits[i];
 		}
-		big->bits[i] = (uint32_t) sum;
-		sum >>= BITSXWORD;
-	}
-	if (sum) {
-		big->bits[len] = sum;
-		len ++;
+		memset(t, 0, len * sizeof(limb_t));
+		t[len] = words_addmul_1(t, r, len, acc);
+		len += (t[len] != 0);
+		limb_t *aux = r;
+		r = t;
+		t = aux;
+		acc = (i < n) ? u[i] : 1;
 	}
-	big->len = len;
+	if (result->words < len)
+		bigint_duplicate_words(result, len);
+	memcpy(result->bits, r, len * sizeof(limb_t));
+	result->len = len;
+	bigint_update_len(result);
+	free(r < t ? r : t);
 }
 
-static void set_div2k_plus_res2k(bigint_t *big, uint32_t k)
+static void prod_tree(const bigint_t *const *v, const uint32_t *u, uint32_t n,
+		      bigint_t *result, int par)
 {
-	/* Return big / 2k + big % 2k
-	 * Example:
-	 *  Big: 101101101111
-	 *            ^
-	 *    k: 6
-	 *  Big / k:  101101
-	 *  Big % k:  101111
-	 *  Result : 1011100
+	/* result <- v[0] ... v[n - 1], or u[0] ... u[n - 1] when v is
+	 * NULL, splitting the factors in halves of the same count. With
+	 * par set the lower half runs as a task.
 	 */
-	uint32_t iword = k >> BXW_2K;
-	if (k == 0 || iword >= big->len)
+	if (!v && n <= PROD_LEAF) {
+		prod_leaf_u32(u, n, result);
 		return;
-	
-	uint32_t ibit = k & BXW_MOD_MASK;
-	uint32_t cbit = BITSXWORD - ibit;
-	
-	uint32_t len = big->len;
+	}
+	if (v && n <= 2) {
+		if (n == 0)
+			bigint_set_u32(result, 1);
+		else if (n == 1)
+			bigint_copy(result, v[0]);
+		else
+			bigint_mul(v[0], v[1], result);
+		return;
+	}
 
-	uint32_t i;
-	uint64_t sum = 0;
-	for (i = 0; i < len; i++) {
-		uint32_t j = i + iword;
-		if (j < big->len) {
-			uint32_t adding = big->bits[j] >> ibit;
-			if (j + 1 < big->len && ibit) {
-				adding |= big->bits[j + 1] << cbit;
-			}
-			if (j == iword && ibit)
-				big->bits[j] = (big->bits[j] << cbit) >> cbit;
-			else
-				big->bits[j] = 0;
-			sum += (uint64_t) big->bits[i] + adding;
+	uint32_t h = n >> 1;
+	bigint_t *lo = bigint_alloc(1);
+	bigint_t *hi = bigint_alloc(1);
+	if (par) {
+		OMP_PRAGMA(omp task)
+		prod_tree(v, u, h, lo, par);
+	} else {
+		prod_tree(v, u, h, lo, par);
+	}
+	prod_tree(v ? v + h : NULL, v ? NULL : u + h, n - h, hi, par);
+	mul_wait(par);
+	bigint_mul(lo, hi, result);
+	bigint_destroy(lo);
+	bigint_destroy(hi);
+}
+
+static void prod_top(const bigint_t *const *v, const uint32_t *u, uint32_t n,
+		     uint64_t words, bigint_t *result)
+{
+	/* Products of about words limbs whose top product splits in
+	 * tasks, as words_mul_top, build the tree in a team of threads.
+	 * Idle threads take the pending subtrees.
+	 */
+#ifdef _OPENMP
+	if (num_threads > 1 && words >= 2 * (uint64_t) parallel_threshold) {
+		if (omp_in_parallel()) {
+			prod_tree(v, u, n, result, 1);
 		} else {
-			if (!sum)
-				break;
-			sum += (uint64_t) big->bits[i];
+			OMP_PRAGMA(omp parallel num_threads(num_threads))
+			OMP_PRAGMA(omp single)
+			prod_tree(v, u, n, result, 1);
 		}
-		big->bits[i] = (uint32_t) sum;
-		sum >>= BITSXWORD;
+		return;
 	}
-	bigint_update_len(big);
+#else
+	(void) words;
+#endif
+	prod_tree(v, u, n, result, 0);
 }
 
-void bigint_div_fast(bigint_t *big, const bigint_t *div, bigint_t *res,
-		     bigint_t *aux1, bigint_t *aux2, bigint_t *aux3)
+static uint32_t prime_swing(uint32_t n, const uint32_t *primes,
+			    uint32_t np, uint32_t *f)
 {
-	/* Perform 10x better than bigint_div if quotient and divisor have 
-	 * similar magnitude.
-	 *  > aux1 (delta) and aux2 (quotient) are used in computation
+	/* f <- the factors p^e of the odd part of the swing
+	 * n! / (n/2)!^2, for the odd primes p <= n, where e counts the
+	 * odd n / p^i. Every p^e is at most n. Returns their count.
 	 */
-	bigint_copy(res, big);
-	bigint_set_u32(big, 0);
-	bigint_set_u32(aux1, 0);
-	uint32_t n = bigint_get_2k_geq(div);
-	bigint_add_2k(aux1, n);
-	bigint_subtract(aux1, div, NULL);
-
-	while (bigint_compare_2k(res, n) > 0 &&
-	       bigint_compare(res, div) > 0) {
-		bigint_copy(aux2, res);
-		bigint_div_2k(aux2, n);
-		bigint_add(big, aux2);
-
-		bigint_copy(aux3, aux2);
-		bigint_mul(aux3, aux1, aux2);
-		
-		bigint_mod_2k(res, n);
-		bigint_add(res, aux2);
+	uint32_t nf = 0;
+	for (uint32_t i = 1; i < np && primes[i] <= n; i++) {
+		uint32_t p = primes[i];
+		uint32_t pe = 1;
+		for (uint32_t q = n / p; q; q /= p)
+			if (q & 1)
+				pe *= p;
+		if (pe > 1)
+			f[nf++] = pe;
 	}
+	return nf;
+}
 
-	if (bigint_compare(res, div) >= 0) {
-		bigint_add_u32(big, 1);
-		bigint_subtract(res, div, NULL);
-	}
+void bigint_prod_array(const bigint_t *const *v, uint32_t n, bigint_t *result)
+{
+	/* result <- v[0] v[1] ... v[n - 1] by a balanced product tree,
+	 * result may be one of the factors.
+	 */
+	uint64_t words = 0;
+	for (uint32_t i = 0; i < n; i++)
+		words += v[i]->len;
+	bigint_t *t = bigint_alloc(1);
+	prod_top(v, NULL, n, words, t);
+	bigint_copy(result, t);
+	bigint_destroy(t);
 }
 
-void bigint_mod_2k(bigint_t *big, uint32_t k)
+void bigint_prod_u32_array(const uint32_t *v, uint32_t n, bigint_t *result)
 {
-	uint32_t mod = k & 31U;
-	uint32_t iw = (k >> BXW_2K) - ((mod > 0) ? 0 : 1);
-	uint32_t mask = (1U << mod) - 1;
-	
-	uint32_t word;
-	bigint_get_word(big, iw, &word);
+	uint64_t bits = 0;
+	for (uint32_t i = 0; i < n; i++)
+		bits += v[i] ? 32 - __builtin_clz(v[i]) : 0;
+	prod_top(NULL, v, n, bits >> BXW_2K, result);
+}
 
-	uint32_t i = iw + 1;
-	while (i < big->len) {
-		big->bits[i] = 0;
-		i ++;
+void bigint_factorial(uint32_t n, bigint_t *result)
+{
+	/* n! = (n/2)!^2 swing(n) from the bottom, with the odd parts only
+	 * and the n - popcount(n) factors 2 shifted in at the end.
+	 */
+	uint32_t k = 0;
+	while ((n >> k) > 20)
+		k++;
+	uint64_t f = 1;
+	for (uint32_t i = 2; i <= (n >> k); i++)
+		f *= i;
+	bigint_set_u64(result, f >> __builtin_ctzll(f));
+	if (k) {
+		uint32_t np;
+		uint32_t *primes = primes_upto(n, &np);
+		uint32_t *sw = malloc(np * sizeof(uint32_t));
+		bigint_t *swing = bigint_alloc(1);
+		bigint_t *sq = bigint_alloc(1);
+		while (k--) {
+			uint32_t m = n >> k;
+			uint32_t nf = prime_swing(m, primes, np, sw);
+			bigint_prod_u32_array(sw, nf, swing);
+			bigint_sqr(result, sq);
+			bigint_mul(sq, swing, result);
+		}
+		bigint_destroy(swing);
+		bigint_destroy(sq);
+		free(sw);
+		free(primes);
 	}
-	big->len = iw + 1;
-	
-	bigint_set_word(big, iw, word & mask);
+	bigint_shift_left(result, n - __builtin_popcount(n));
 }
 
-void bigint_mod_2kless1(bigint_t *big, uint32_t k)
+void bigint_binomial(uint32_t n, uint32_t k, bigint_t *result)
 {
-	while (bigint_compare_2k(big, k) >= 0) {
-		set_div2k_plus_res2k(big, k);
+	/* The exponent of p in n! / (k! (n - k)!) is the number of
+	 * borrows subtracting k from n in base p, and p^e <= n. For k
+	 * small against n the product n (n - 1) ... (n - k + 1) is
+	 * divided by k! instead of sieving up to n.
+	 */
+	if (k > n) {
+		bigint_set_u32(result, 0);
+		return;
+	}
+	k = MIN(k, n - k);
+	if (k < n / 16) {
+		uint32_t *f = malloc(MAX(k, 1) * sizeof(uint32_t));
+		for (uint32_t i = 0; i < k; i++)
+			f[i] = n - i;
+		bigint_t *den = bigint_alloc(1);
+		bigint_t *rem = bigint_alloc(1);
+		bigint_prod_u32_array(f, k, result);
+		bigint_factorial(k, den);
+		bigint_div(result, den, rem);
+		bigint_destroy(den);
+		bigint_destroy(rem);
+		free(f);
+		return;
 	}
 
-	if (bigint_compare_2kless1(big, k) >= 0) {
-		bigint_add_u32(big, 1);
-		bigint_subtract_2k(big, k, NULL);
+	uint32_t np;
+	uint32_t *primes = primes_upto(n, &np);
+	uint32_t nf = 0;
+	for (uint32_t i = 0; i < np; i++) {
+		uint32_t p = primes[i];
+		uint32_t pe = 1;
+		uint32_t borrow = 0;
+		for (uint32_t a = n, b = k; a; a /= p, b /= p) {
+			borrow = (a % p < b % p + borrow);
+			if (borrow)
+				pe *= p;
+		}
+		if (pe > 1)
+			primes[nf++] = pe;
 	}
+	bigint_prod_u32_array(primes, nf, result);
+	free(primes);
 }
 
-void bigint_mod(bigint_t *big, const bigint_t *div,
-		bigint_t *aux1, bigint_t *aux2, bigint_t *aux3)
+void bigint_primorial(uint32_t n, bigint_t *result)
 {
-	/* Auxiliary structures used in computation:
-	 *   > aux1 (delta)
-	 *   > aux2 (iterative quotient)
-	 */
-	bigint_set_u32(aux1, 0);
-	uint32_t n = bigint_get_2k_geq(div);
-	bigint_set_u32(aux1, 0);
-	bigint_add_2k(aux1, n);
-	bigint_subtract(aux1, div, NULL);
-
-	while (bigint_compare_2k(big, n) > 0 &&
-	       bigint_compare(big, div) > 0) {
-		bigint_copy(aux2, big);
-		bigint_div_2k(aux2, n);
-
-		bigint_copy(aux3, aux2);
-		bigint_mul(aux3, aux1, aux2);
-		
-		bigint_mod_2k(big, n);
-		bigint_add(big, aux2);
-	}
+	/* result <- product of the primes up to n */
+	uint32_t np;
+	uint32_t *primes = primes_upto(n, &np);
+	bigint_prod_u32_array(primes, np, result);
+	free(primes);
+}
 
-	if (bigint_compare(big, div) >= 0) {
-		bigint_subtract(big, div, NULL);
-	}
+bigint_batch_t *bigint_batch_create(uint32_t count, uint32_t words)
+{
+	/* count numbers of words 32 bits words each, all zero */
+	bigint_batch_t *batch = malloc(sizeof(*batch));
+	batch->count = count;
+	batch->words = MAX(words, 1);
+	batch->stride = (count + BATCH_LANES - 1) & ~(BATCH_LANES - 1);
+	batch->w = calloc((size_t) batch->words * batch->stride,
+			  sizeof(uint32_t));
+	return batch;
 }
 
-void bigint_get_binary_string(const bigint_t *big, char *str)
+void bigint_batch_destroy(bigint_batch_t *batch)
 {
-	uint32_t i, j;
-	uint32_t len = big->len;
-	for (i = 0; i < len; i++) {
-		uint32_t a = big->bits[i];
-		for (j = 0; j < BITSXWORD; j++) {
-			uint32_t idx = ((len - i) << BXW_2K) - j - 1;
-			if (a & 1)
-				str[idx] = '1';
-			else
-				str[idx] = '0';
-			a >>= 1;
-		}
-	}
-	str[len << BXW_2K] = '\0';
+	if (!batch)
+		return;
+	free(batch->w);
+	free(batch);
 }
 
-void bigint_get_hexadec_string(const bigint_t *big, char *str)
+void bigint_batch_set(bigint_batch_t *batch, uint32_t j, const bigint_t *big)
 {
-	int len = big->len;
-	if (len) {
-		int j = 0;
-		uint32_t w = big->bits[len - 1];
-		for (int k = 0; k < 8; k++) {
-			int bits = 4 * (7 - k);
-			int v = (w >> bits) & 15;
-			if (v || j) {
-				str[j] = char_dec2hex(v);
-				j ++;
-			}
-		}
-		for (int i = 1; i < len; i++) {
-			w = big->bits[len - 1 - i];
-			for (int k = 0; k < 8; k++) {
-				int bits = 4 * (7 - k);
-				int v = (w >> bits) & 15;
-				if (v || j) {
-					str[j] = char_dec2hex(v);
-					j ++;
-				}
-			}
-		}
-		str[j] = 0;
-	} else {
-		strcpy(str, "0");
-	}
+	/* Number j <- big mod 2^(32 words) */
+	uint32_t per = BITSXWORD / 32;
+	uint32_t n = MIN(batch->words, big->len * per);
+	uint32_t *w = batch->w + j;
+	for (uint32_t i = 0; i < n; i++)
+		w[(size_t) i * batch->stride] =
+			(uint32_t) (big->bits[i / per] >> (32 * (i % per)));
+	for (uint32_t i = n; i < batch->words; i++)
+		w[(size_t) i * batch->stride] = 0;
 }
 
-static char char_dec2hex(int n)
+void bigint_batch_get(const bigint_batch_t *batch, uint32_t j, bigint_t *big)
 {
-	if (n < 10)
-		return (char) (n + 48);
-	else if (n < 16)
-		return (char) (n - 10 + 65);
-	else
-		return '?'; // Report error
+	/* big <- number j */
+	uint32_t per = BITSXWORD / 32;
+	uint32_t n = (batch->words + per - 1) / per;
+	const uint32_t *w = batch->w + j;
+	if (big->words < n)
+		bigint_duplicate_words(big, n);
+	memset(big->bits, 0, n * sizeof(limb_t));
+	for (uint32_t i = 0; i < batch->words; i++)
+		big->bits[i / per] |= (limb_t) w[(size_t) i * batch->stride] <<
+			(32 * (i % per));
+	big->len = n;
+	bigint_update_len(big);
 }
 
-static void reverse_string(char *str, int len)
+void bigint_batch_load(bigint_batch_t *batch, bigint_t *const *src)
 {
-	uint32_t n = len / 2;
-	for (uint32_t i = 0; i < n; i++) {
-		char aux = str[i];
-		str[i] = str[len - 1 - i];
-		str[len - 1 - i] = aux;
-	}
+	for (uint32_t j = 0; j < batch->count; j++)
+		bigint_batch_set(batch, j, src[j]);
+}
 
+void bigint_batch_store(const bigint_batch_t *batch, bigint_t **dst)
+{
+	for (uint32_t j = 0; j < batch->count; j++)
+		bigint_batch_get(batch, j, dst[j]);
 }
 
-void bigint_get_decimal_string(const bigint_t *big, char* str)
+void bigint_batch_add(const bigint_batch_t *a, const bigint_batch_t *b,
+		      bigint_batch_t *result)
 {
-	if (big->len) {
-		bigint_t *cp = bigint_clone(big);
-		uint32_t i = 0;
-		for (int d = 8; d > 0; d--) {
-			uint32_t m = 10;
-			for (int j = 1; j < d; j++)
-				m *= 10;
-	    
-			while (bigint_gt(cp, 0)) {
-				uint32_t res;
-				bigint_div_u32(cp, m, &res);
-				uint32_t zeros = 0;
-				uint32_t mcp = m / 10;
-				int gtz = bigint_gt(cp, 0);
-				while (gtz && mcp > res) {
-					mcp /= 10;
-					zeros ++;
-				}
-				while (res) {
-					int r = res % 10;
-					res /= 10;
-					str[i] = r + 48;
-					i ++;
-				}	
-				while (gtz && zeros) {
-					zeros --;
-					str[i] = '0';
-					i ++;
-				}
+	/* result <- a + b mod 2^(32 words of result), lane by lane. All
+	 * three hold the same count, result may be a or b.
+	 */
+	uint32_t stride = result->stride;
+	uint32_t c[BATCH_CHUNK];
+	for (uint32_t j0 = 0; j0 < stride; j0 += BATCH_CHUNK) {
+		uint32_t lanes = MIN(BATCH_CHUNK, stride - j0);
+		memset(c, 0, lanes * sizeof(uint32_t));
+		for (uint32_t i = 0; i < result->words; i++) {
+			const uint32_t *x = a->w + (size_t) i * stride + j0;
+			const uint32_t *y = b->w + (size_t) i * stride + j0;
+			uint32_t *r = result->w + (size_t) i * stride + j0;
+			int hx = i < a->words, hy = i < b->words;
+			for (uint32_t j = 0; j < lanes; j++) {
+				uint64_t s = (uint64_t) c[j] + (hx ? x[j] : 0) +
+					(hy ? y[j] : 0);
+				r[j] = (uint32_t) s;
+				c[j] = (uint32_t) (s >> 32);
 			}
 		}
-		bigint_destroy(cp);
-		str[i] = '\0';
-		reverse_string(str, i);
-	} else {
-		strcpy(str, "0");
 	}
 }
 
-static void pow_iterative(bigint_t *big, uint32_t p, bigint_t *aux)
-/* This function assumes p > 0 */
-{	
-	if (bigint_is_zero(big))
+void bigint_batch_mul(const bigint_batch_t *a, const bigint_batch_t *b,
+		      bigint_batch_t *result)
+{
+	/* result <- a b mod 2^(32 words of result), schoolbook over the
+	 * lanes. result must be another batch than a and b.
+	 */
+	uint32_t stride = result->stride;
+	uint32_t nr = result->words;
+	uint32_t c[BATCH_CHUNK];
+	memset(result->w, 0, (size_t) nr * stride * sizeof(uint32_t));
+	for (uint32_t j0 = 0; j0 < stride; j0 += BATCH_CHUNK) {
+		uint32_t lanes = MIN(BATCH_CHUNK, stride - j0);
+		for (uint32_t i = 0; i < MIN(a->words, nr); i++) {
+			const uint32_t *x = a->w + (size_t) i * stride + j0;
+			uint32_t nk = MIN(b->words, nr - i);
+			memset(c, 0, lanes * sizeof(uint32_t));
+			for (uint32_t k = 0; k < nk; k++)
+				lanes_addmul(result->w + (size_t) (i + k) *
+					     stride + j0, x, b->w + (size_t) k *
+					     stride + j0, c, lanes);
+			if (i + nk < nr)
+				lanes_set_carry(result->w + (size_t) (i + nk) *
+						stride + j0, c, lanes);
+		}
+	}
+}
+
+void bigint_batch_mulmod(const bigint_batch_t *a, const bigint_batch_t *b,
+			 const bigint_t *mod, bigint_batch_t *result)
+{
+	/* result <- a b mod mod, result holding its words. Odd moduli
+	 * run Montgomery's product over the lanes, a b R^-1 and then
+	 * times R^2 R^-1, on copies reduced mod mod if some number of a
+	 * or b is not below it. Even ones go a number at a time. result
+	 * may be a or b.
+	 */
+	uint32_t stride = result->stride;
+	if (!bigint_get_lsbit(mod)) {
+		/* PENDING: Set infty on zero */
+		bigint_t *x = bigint_alloc(1), *y = bigint_alloc(1);
+		bigint_t *r = bigint_alloc(1);
+		for (uint32_t j = 0; j < result->count; j++) {
+			bigint_batch_get(a, j, x);
+			bigint_batch_get(b, j, y);
+			bigint_mul(x, y, r);
+			bigint_set_u32(y, 0);
+			if (!bigint_is_zero(mod))
+				bigint_div(r, mod, y);
+			bigint_batch_set(result, j, y);
+		}
+		bigint_destroy(x);
+		bigint_destroy(y);
+		bigint_destroy(r);
 		return;
+	}
 
-	uint32_t len = big->len * p;
-	if (aux->words < len)
-		bigint_duplicate_words(aux, len);
-	if (big->words < len)
-		bigint_duplicate_words(big, len);
-        
-	while (--p) {
-		bigint_set_u32(aux, 0);
-		uint32_t i;
-		for (i = 0; i < big->len; i ++) {
-			add_mul_word(big, big->bits[i], aux, i);
+	/* The modulus, -m^-1 mod 2^32 and R^2 mod m in 32 bits words */
+	uint32_t per = BITSXWORD / 32;
+	uint32_t n = (bigint_index_of_msbit(mod) >> 5) + 1;
+	uint32_t *m = malloc(2 * n * sizeof(uint32_t));
+	uint32_t *r2 = m + n;
+	bigint_t *x = bigint_alloc(2 * (n / per) + 3);
+	bigint_t *rem = bigint_alloc(2 * (n / per) + 3);
+	bigint_add_2k(x, 64 * n);
+	bigint_divrem(NULL, rem, x, mod);
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t k = i / per, sh = 32 * (i % per);
+		m[i] = (uint32_t) (mod->bits[k] >> sh);
+		r2[i] = k < rem->len ? (uint32_t) (rem->bits[k] >> sh) : 0;
+	}
+	bigint_destroy(x);
+	bigint_destroy(rem);
+	uint32_t inv = m[0];
+	for (int i = 0; i < 4; i++)
+		inv *= 2 - m[0] * inv;
+	uint32_t ninv = -inv;
+	bigint_batch_t *ra = batch_reduce(a, mod, m, n);
+	bigint_batch_t *rb = batch_reduce(b, mod, m, n);
+	if (ra)
+		a = ra;
+	if (rb)
+		b = rb;
+
+	/* t holds the 2 n + 2 rows of a product, p its reduction */
+	uint32_t *t = malloc((size_t) (3 * n + 2) * BATCH_CHUNK *
+			     sizeof(uint32_t));
+	uint32_t *p = t + (size_t) (2 * n + 2) * BATCH_CHUNK;
+	uint32_t c[BATCH_CHUNK];
+	for (uint32_t j0 = 0; j0 < stride; j0 += BATCH_CHUNK) {
+		uint32_t lanes = MIN(BATCH_CHUNK, stride - j0);
+		memset(t, 0, (size_t) (2 * n + 2) * BATCH_CHUNK *
+		       sizeof(uint32_t));
+		for (uint32_t i = 0; i < MIN(a->words, n); i++) {
+			const uint32_t *xi = a->w + (size_t) i * stride + j0;
+			uint32_t nk = MIN(b->words, n);
+			memset(c, 0, lanes * sizeof(uint32_t));
+			for (uint32_t k = 0; k < nk; k++)
+				lanes_addmul(t + (i + k) * BATCH_CHUNK, xi,
+					     b->w + (size_t) k * stride + j0,
+					     c, lanes);
+			lanes_set_carry(t + (i + nk) * BATCH_CHUNK, c, lanes);
+		}
+		batch_redc(p, t, m, ninv, n, lanes);
+
+		/* p R^2 R^-1 */
+		memset(t, 0, (size_t) (2 * n + 2) * BATCH_CHUNK *
+		       sizeof(uint32_t));
+		for (uint32_t i = 0; i < n; i++) {
+			memset(c, 0, lanes * sizeof(uint32_t));
+			for (uint32_t k = 0; k < n; k++)
+				lanes_addmul_1(t + (i + k) * BATCH_CHUNK,
+					       p + k * BATCH_CHUNK, r2[i], c,
+					       lanes);
+			lanes_set_carry(t + (i + n) * BATCH_CHUNK, c, lanes);
+		}
+		batch_redc(p, t, m, ninv, n, lanes);
+
+		for (uint32_t i = 0; i < result->words; i++) {
+			uint32_t *r = result->w + (size_t) i * stride + j0;
+			if (i < n)
+				memcpy(r, p + i * BATCH_CHUNK,
+				       lanes * sizeof(uint32_t));
+			else
+				memset(r, 0, lanes * sizeof(uint32_t));
 		}
-		bigint_copy(big, aux);
 	}
+	free(t);
+	free(m);
+	bigint_batch_destroy(ra);
+	bigint_batch_destroy(rb);
 }
 
-void bigint_pow(bigint_t *big, uint32_t p, bigint_t *aux)
+static void lanes_addmul(uint32_t *r, const uint32_t *x, const uint32_t *y,
+			 uint32_t *c, uint32_t n)
 {
-	switch (p) {
-	case 0:
-		bigint_set_u32(big, 1);
-		return;
-	case 1:
-		return;
-	case 4:
-		pow_iterative(big, 2, aux);
-		pow_iterative(big, 2, aux);
-		return;
-	case 6:
-		pow_iterative(big, 3, aux);
-		pow_iterative(big, 2, aux);
-		return;
-	case 8:
-		pow_iterative(big, 2, aux);
-		pow_iterative(big, 2, aux);
-		pow_iterative(big, 2, aux);
-		return;
-	case 9:
-		pow_iterative(big, 3, aux);
-		pow_iterative(big, 3, aux);
-		return;
-	default:
-		pow_iterative(big, p, aux);
+	/* r[j] + x[j] y[j] + c[j] for j < n, below 2^64, the low words
+	 * go to r and the high ones to c.
+	 */
+#ifdef BIGINT_X86_64_KERNELS
+	if (lanes_avx2 && mul_kernel != BIGINT_KERNEL_C) {
+		lanes_addmul_avx2(r, x, y, c, n);
 		return;
 	}
+#endif
+	for (uint32_t j = 0; j < n; j++) {
+		uint64_t s = (uint64_t) x[j] * y[j] + r[j] + c[j];
+		r[j] = (uint32_t) s;
+		c[j] = (uint32_t) (s >> 32);
+	}
 }
 
-static uint32_t sqrt_u32(uint32_t n, uint32_t *res)
+static void lanes_addmul_1(uint32_t *r, const uint32_t *x, uint32_t y,
+			   uint32_t *c, uint32_t n)
 {
-	*res  = n;
-	n = 0;
-	uint32_t bit = 1;
-	bit <<= 30;
-
-	while (bit > *res)
-		bit >>= 2;
-
-	while (bit) {
-		if (*res >= n + bit) {
-			(*res) -= (n + bit);
-			n += (bit << 1);
-		}
-		n >>= 1;
-		bit >>= 2;
+	/* Same as lanes_addmul with y[j] = y */
+#ifdef BIGINT_X86_64_KERNELS
+	if (lanes_avx2 && mul_kernel != BIGINT_KERNEL_C) {
+		lanes_addmul_1_avx2(r, x, y, c, n);
+		return;
+	}
+#endif
+	for (uint32_t j = 0; j < n; j++) {
+		uint64_t s = (uint64_t) x[j] * y + r[j] + c[j];
+		r[j] = (uint32_t) s;
+		c[j] = (uint32_t) (s >> 32);
 	}
-	return n;
 }
 
-static uint64_t sqrt_u64(uint64_t n, uint64_t *res)
+static void lanes_set_carry(uint32_t *r, const uint32_t *c, uint32_t n)
 {
-	*res  = n;
-	n = 0;
-	uint64_t bit = 1;
-	bit <<= 62;
+	/* r[j] <- c[j], the row above a schoolbook pass is still zero */
+	for (uint32_t j = 0; j < n; j++)
+		r[j] = c[j];
+}
 
-	while (bit > *res)
-		bit >>= 2;
+static void batch_redc(uint32_t *r, uint32_t *t, const uint32_t *m,
+		       uint32_t ninv, uint32_t n, uint32_t lanes)
+{
+	/* r <- t 2^(-32 n) mod m lane by lane for t < m 2^(32 n), rows
+	 * of BATCH_CHUNK words. t has 2 n + 1 rows and is destroyed.
+	 * Same as mont_reduce_words, cc is the carry into row i + n.
+	 */
+	uint32_t c[BATCH_CHUNK], cc[BATCH_CHUNK];
+	uint32_t u[BATCH_CHUNK];
+	memset(cc, 0, lanes * sizeof(uint32_t));
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t *ti = t + i * BATCH_CHUNK;
+		uint32_t *tn = ti + n * BATCH_CHUNK;
+		for (uint32_t j = 0; j < lanes; j++)
+			u[j] = ti[j] * ninv;
+		memset(c, 0, lanes * sizeof(uint32_t));
+		for (uint32_t k = 0; k < n; k++)
+			lanes_addmul_1(ti + k * BATCH_CHUNK, u, m[k], c, lanes);
+		for (uint32_t j = 0; j < lanes; j++) {
+			uint64_t s = (uint64_t) tn[j] + c[j] + cc[j];
+			tn[j] = (uint32_t) s;
+			cc[j] = (uint32_t) (s >> 32);
+		}
+	}
 
-	while (bit) {
-		if (*res >= n + bit) {
-			(*res) -= (n + bit);
-			n += (bit << 1);
+	/* t[n..2 n) + cc 2^(32 n) < 2 m, subtract m unless below m */
+	uint32_t *tn = t + n * BATCH_CHUNK;
+	int64_t s[BATCH_CHUNK];
+	memset(s, 0, lanes * sizeof(int64_t));
+	for (uint32_t k = 0; k < n; k++) {
+		uint32_t *rk = r + k * BATCH_CHUNK, *tk = tn + k * BATCH_CHUNK;
+		for (uint32_t j = 0; j < lanes; j++) {
+			s[j] += (int64_t) tk[j] - m[k];
+			rk[j] = (uint32_t) s[j];
+			s[j] >>= 32;
+		}
+	}
+	for (uint32_t k = 0; k < n; k++) {
+		uint32_t *rk = r + k * BATCH_CHUNK, *tk = tn + k * BATCH_CHUNK;
+		for (uint32_t j = 0; j < lanes; j++) {
+			uint32_t keep = -(uint32_t) (s[j] + (int64_t) cc[j] < 0);
+			rk[j] = (rk[j] & ~keep) | (tk[j] & keep);
 		}
-		n >>= 1;
-		bit >>= 2;
 	}
-	return n;
 }
 
-static uint32_t get_2k_4div_leq(const bigint_t *big)
+static int batch_below(const bigint_batch_t *a, uint32_t j,
+		       const uint32_t *m, uint32_t n)
 {
-	uint32_t w = 1;
-	w <<= 30;
-	uint32_t word = big->bits[big->len - 1];
-	uint32_t bit = 0;
-	while (w > word) {
-		w >>= 1;
-		bit ++;
+	/* Whether number j of a is below the n words of m */
+	const uint32_t *w = a->w + j;
+	for (uint32_t i = MAX(a->words, n); i-- > 0;) {
+		uint32_t wi = (i < a->words) ? w[(size_t) i * a->stride] : 0;
+		uint32_t mi = (i < n) ? m[i] : 0;
+		if (wi != mi)
+			return wi < mi;
 	}
-	return bit + (big->len - 1) << BXW_2K;
+	return 0;
 }
 
-static void sqrt_ubig(bigint_t *big, bigint_t *res)
+static bigint_batch_t *batch_reduce(const bigint_batch_t *a,
+				    const bigint_t *mod, const uint32_t *m,
+				    uint32_t n)
 {
-	bigint_copy(res, big);
-	bigint_set_u32(big, 0);
-	
-	uint32_t bit = get_2k_4div_leq(res);
-	
-	while (1) {
-		bigint_add_2k(big, bit);
-		if (bigint_compare(res, big) >= 0) {
-			bigint_subtract(res, big, NULL);
-			bigint_add_2k(big, bit);
-		} else {
-			bigint_subtract_2k(big, bit, NULL);
+	/* NULL if every number of a is below mod, m its n words.
+	 * Otherwise a copy of n words with the numbers mod mod.
+	 */
+	bigint_batch_t *copy = NULL;
+	bigint_t *x = NULL, *y = NULL;
+	for (uint32_t j = 0; j < a->count; j++) {
+		if (batch_below(a, j, m, n))
+			continue;
+		if (!copy) {
+			/* The other numbers fit in n words */
+			copy = bigint_batch_create(a->count, n);
+			for (uint32_t i = 0; i < MIN(a->words, n); i++)
+				memcpy(copy->w + (size_t) i * copy->stride,
+				       a->w + (size_t) i * a->stride,
+				       a->stride * sizeof(uint32_t));
+			x = bigint_alloc(1);
+			y = bigint_alloc(1);
 		}
-		bigint_shift_right(big, 1);
-		if (bit < 2)
-			break;
-		bit -= 2;
+		bigint_batch_get(a, j, x);
+		bigint_div(x, mod, y);
+		bigint_batch_set(copy, j, y);
 	}
-}
-
-void bigint_sqrt(bigint_t *big, bigint_t *res)
-{
-	if (big->len < 2) {		
-		uint32_t a = bigint_truncate_u32(big);
-		uint32_t r;
-		a = sqrt_u32(a, &r);
-		bigint_set_u32(big, a);
-		bigint_set_u32(res, r);
-	} else if (big->len == 2) {
-		uint64_t a = bigint_truncate_u64(big);
-		uint64_t r;
-		a = sqrt_u64(a, &r);
-		bigint_set_u64(big, a);
-		bigint_set_u64(res, r);
-	} else {
-		sqrt_ubig(big, res);
+	if (copy) {
+		bigint_destroy(x);
+		bigint_destroy(y);
 	}
+	return copy;
 }
@@ -3,16 +3,32 @@
 
 #include <stdint.h>
 
+#define BIGINT_KERNEL_AUTO 0
+#define BIGINT_KERNEL_C 1
+#define BIGINT_KERNEL_ADX 2
+#define BIGINT_KERNEL_IFMA 3
+
 typedef struct bigint_s bigint_t;
+typedef struct bigint_barrett_s bigint_barrett_t;
+typedef struct bigint_mont_s bigint_mont_t;
+typedef struct bigint_arena_s bigint_arena_t;
+typedef struct bigint_batch_s bigint_batch_t;
+typedef uint64_t (*bigint_rng_t)(void);
 
 bigint_t *bigint_create(uint32_t words);
 bigint_t *bigint_clone(const bigint_t *src);
 void bigint_destroy(bigint_t *big);
+bigint_arena_t *bigint_arena_create(uint32_t words);
+void bigint_arena_destroy(bigint_arena_t *arena);
+bigint_t *bigint_create_in(bigint_arena_t *arena, uint32_t words);
+void bigint_reserve(bigint_t *big, uint32_t words);
+void bigint_shrink_to_fit(bigint_t *big);
+uint32_t bigint_capacity(const bigint_t *big);
 
 void bigint_set_u32(bigint_t *big, uint32_t a);
 void bigint_set_u64(bigint_t *big, uint64_t a);
 void bigint_set_hexadec(bigint_t *big, const char *hexadec);
-void bigint_set_decimal(bigint_t *big, const char *decimal, bigint_t *aux);
+void bigint_set_decimal(bigint_t *big, const char *decimal, int *status);
 void bigint_copy(bigint_t *big, const bigint_t *src);
 int bigint_is_zero(const bigint_t *big);
 int bigint_gt(const bigint_t *big, uint32_t gt);
@@ -47,6 +63,26 @@ void bigint_mul_u32(const bigint_t *big, uint32_t x, bigint_t *result);
 void bigint_mul_u64(const bigint_t *big, uint64_t x, bigint_t *result);
 void bigint_mul_2k(bigint_t *big, uint32_t bit);
 void bigint_mul(const bigint_t *big, const bigint_t *x, bigint_t *result);
+void bigint_sqr(const bigint_t *big, bigint_t *result);
+void bigint_set_karatsuba_threshold(uint32_t words);
+void bigint_set_sqr_karatsuba_threshold(uint32_t words);
+void bigint_set_toom3_threshold(uint32_t words);
+void bigint_set_toom4_threshold(uint32_t words);
+void bigint_set_ntt_threshold(uint32_t words);
+uint32_t bigint_get_karatsuba_threshold(void);
+uint32_t bigint_get_sqr_karatsuba_threshold(void);
+uint32_t bigint_get_toom3_threshold(void);
+uint32_t bigint_get_toom4_threshold(void);
+uint32_t bigint_get_ntt_threshold(void);
+void bigint_set_decimal_threshold(uint32_t words);
+void bigint_set_hgcd_threshold(uint32_t words);
+void bigint_set_parallel_threshold(uint32_t words);
+uint32_t bigint_get_decimal_threshold(void);
+uint32_t bigint_get_parallel_threshold(void);
+void bigint_set_num_threads(uint32_t threads);
+uint32_t bigint_get_num_threads(void);
+void bigint_set_kernel(int kernel, int *status);
+int bigint_get_kernel(void);
 void bigint_div_u32(bigint_t *big, uint32_t div, uint32_t *res);
 void bigint_div_u64(bigint_t *big, uint64_t div, uint64_t *res);
 void bigint_div_2k(bigint_t *big, uint32_t k);
@@ -58,10 +94,54 @@ void bigint_mod_2k(bigint_t *big, uint32_t k);
 void bigint_mod_2kless1(bigint_t *big, uint32_t k);
 void bigint_mod(bigint_t *big, const bigint_t *div,
 		bigint_t *aux1, bigint_t *aux2, bigint_t *aux3);
+bigint_barrett_t *bigint_barrett_create(const bigint_t *mod);
+void bigint_barrett_destroy(bigint_barrett_t *ctx);
+void bigint_barrett_reduce(bigint_barrett_t *ctx, bigint_t *big);
+void bigint_barrett_mulmod(bigint_barrett_t *ctx, const bigint_t *a,
+			   const bigint_t *b, bigint_t *result);
+bigint_mont_t *bigint_mont_create(const bigint_t *mod);
+void bigint_mont_destroy(bigint_mont_t *ctx);
+void bigint_to_mont(bigint_mont_t *ctx, const bigint_t *big, bigint_t *result);
+void bigint_from_mont(bigint_mont_t *ctx, const bigint_t *big,
+		      bigint_t *result);
+void bigint_mont_mul(bigint_mont_t *ctx, const bigint_t *a, const bigint_t *b,
+		     bigint_t *result);
+void bigint_mont_sqr(bigint_mont_t *ctx, const bigint_t *a, bigint_t *result);
+void bigint_powmod(const bigint_t *base, const bigint_t *exp,
+		   const bigint_t *mod, bigint_t *result);
 void bigint_get_binary_string(const bigint_t *big, char *str);
 void bigint_get_hexadec_string(const bigint_t *big, char *str);
+uint32_t bigint_write_hexadec_string(const bigint_t *big, char *str);
 void bigint_get_decimal_string(const bigint_t *big, char* str);
+uint32_t bigint_decimal_length_bound(const bigint_t *big);
 void bigint_pow(bigint_t *big, uint32_t p, bigint_t *aux);
+void bigint_pow_u64(bigint_t *big, uint64_t p, bigint_t *aux, int *status);
 void bigint_sqrt(bigint_t *big, bigint_t *res);
+void bigint_root(bigint_t *big, uint32_t k, bigint_t *rem, int *status);
+int bigint_is_perfect_square(const bigint_t *big);
+void bigint_gcd(const bigint_t *a, const bigint_t *b, bigint_t *result);
+int bigint_gcdext(const bigint_t *a, const bigint_t *b, bigint_t *g,
+		  bigint_t *s, bigint_t *t);
+void bigint_modinv(const bigint_t *a, const bigint_t *mod, bigint_t *result,
+		   int *status);
+int bigint_is_probable_prime(const bigint_t *big, uint32_t rounds);
+void bigint_get_prime(bigint_t *big, uint32_t nbits, bigint_rng_t rng);
+void bigint_prod_array(const bigint_t *const *v, uint32_t n, bigint_t *result);
+void bigint_prod_u32_array(const uint32_t *v, uint32_t n, bigint_t *result);
+void bigint_factorial(uint32_t n, bigint_t *result);
+void bigint_binomial(uint32_t n, uint32_t k, bigint_t *result);
+void bigint_primorial(uint32_t n, bigint_t *result);
+bigint_batch_t *bigint_batch_create(uint32_t count, uint32_t words);
+void bigint_batch_destroy(bigint_batch_t *batch);
+void bigint_batch_set(bigint_batch_t *batch, uint32_t j, const bigint_t *big);
+void bigint_batch_get(const bigint_batch_t *batch, uint32_t j, bigint_t *big);
+void bigint_batch_load(bigint_batch_t *batch, bigint_t *const *src);
+void bigint_batch_store(const bigint_batch_t *batch, bigint_t **dst);
+void bigint_batch_add(const bigint_batch_t *a, const bigint_batch_t *b,
+		      bigint_batch_t *result);
+void bigint_batch_mul(const bigint_batch_t *a, const bigint_batch_t *b,
+		      bigint_batch_t *result);
+void bigint_batch_mulmod(const bigint_batch_t *a, const bigint_batch_t *b,
+			 const bigint_t *mod, bigint_batch_t *result);
   
 #endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include "bigint.h"
@@ -19,7 +20,32 @@ int test_div_u32(int action, void **resources);
 int test_div(int action, void **resources);
 int test_div_2kless1(int action, void **resources);
 int test_div_fast(int action, void **resources);
+int test_mul_karatsuba(int action, void **resources);
+int test_mul_toom(int action, void **resources);
+int test_mul_ntt(int action, void **resources);
+int test_mul_threads(int action, void **resources);
+int test_sqr(int action, void **resources);
+int test_pow(int action, void **resources);
+int test_div_words(int action, void **resources);
+int test_div_u64(int action, void **resources);
+int test_barrett(int action, void **resources);
+int test_powmod(int action, void **resources);
+int test_kernels(int action, void **resources);
+int test_add_sub(int action, void **resources);
+int test_decimal_string(int action, void **resources);
+int test_set_decimal(int action, void **resources);
+int test_hexadec(int action, void **resources);
+int test_arena(int action, void **resources);
+int test_inline_limbs(int action, void **resources);
+int test_capacity(int action, void **resources);
+int test_stale_limbs(int action, void **resources);
+int test_sqrt_root(int action, void **resources);
+int test_gcd(int action, void **resources);
+int test_prime(int action, void **resources);
+int test_batch(int action, void **resources);
+int test_prod(int action, void **resources);
 
+static uint64_t test_rng(void);
 static int run_tests(int N, int (*tests[])());
 static int can_execute_test(int Ntimes, int (*test)());
 static uint64_t get_millis();
@@ -27,14 +53,38 @@ static void print_summary(int N, int failed);
 
 int main()
 {
-	int N = 6;
-	int (*tests[6])(int, void**) = {
+	int N = 30;
+	int (*tests[30])(int, void**) = {
 		test_mul_u32,
 		test_mul,
 		test_div_u32,
 		test_div,
 		test_div_2kless1,
-		test_div_fast
+		test_div_fast,
+		test_mul_karatsuba,
+		test_mul_toom,
+		test_mul_ntt,
+		test_mul_threads,
+		test_sqr,
+		test_pow,
+		test_div_words,
+		test_div_u64,
+		test_barrett,
+		test_powmod,
+		test_kernels,
+		test_add_sub,
+		test_decimal_string,
+		test_set_decimal,
+		test_hexadec,
+		test_arena,
+		test_inline_limbs,
+		test_capacity,
+		test_stale_limbs,
+		test_sqrt_root,
+		test_gcd,
+		test_prime,
+		test_batch,
+		test_prod
 	};
 	int failed = run_tests(N, tests);
 	print_summary(N, failed);
@@ -281,3 +331,1205 @@ int test_div_fast(int action, void **resources)
 		return 0;
 	}
 }
+
+int test_mul_karatsuba(int action, void **resources)
+{
+	int n = 40;
+	bigint_t **res;
+	int cmp;
+	uint32_t kar;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(4*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		res[3] = bigint_create(100);
+		for (int i = 0; i < n; i++) {
+			bigint_set_word(res[0], i, 0x9E3779B9U * (i + 1));
+			bigint_set_word(res[1], i, 0xFFFFFFFFU - i);
+		}
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		kar = bigint_get_karatsuba_threshold();
+		bigint_set_karatsuba_threshold(8);
+		bigint_mul(res[0], res[1], res[2]);
+		bigint_set_karatsuba_threshold(1000);
+		bigint_mul(res[0], res[1], res[3]);
+		cmp = bigint_compare(res[2], res[3]);
+		bigint_set_karatsuba_threshold(kar);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		bigint_destroy(res[3]);
+		return 0;
+	}
+}
+
+int test_mul_toom(int action, void **resources)
+{
+	int n = 34;
+	bigint_t **res;
+	int cmp;
+	uint32_t kar, t3, t4;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(5*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		res[3] = bigint_create(100);
+		res[4] = bigint_create(100);
+		for (int i = 0; i < n; i++) {
+			bigint_set_word(res[0], i, 0x9E3779B9U * (i + 1));
+			bigint_set_word(res[1], i, 0xFFFFFFFFU - i);
+		}
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		kar = bigint_get_karatsuba_threshold();
+		t3 = bigint_get_toom3_threshold();
+		t4 = bigint_get_toom4_threshold();
+		bigint_set_karatsuba_threshold(24);
+		bigint_set_toom3_threshold(16);
+		bigint_mul(res[0], res[1], res[2]);
+		bigint_set_toom4_threshold(32);
+		bigint_mul(res[0], res[1], res[3]);
+		bigint_set_karatsuba_threshold(1000);
+		bigint_mul(res[0], res[1], res[4]);
+		cmp = bigint_compare(res[2], res[4]) ||
+			bigint_compare(res[3], res[4]);
+		bigint_set_karatsuba_threshold(kar);
+		bigint_set_toom3_threshold(t3);
+		bigint_set_toom4_threshold(t4);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		bigint_destroy(res[3]);
+		bigint_destroy(res[4]);
+		return 0;
+	}
+}
+
+int test_mul_ntt(int action, void **resources)
+{
+	int n = 12;
+	bigint_t **res;
+	int cmp;
+	uint32_t kar, nt;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(4*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		res[3] = bigint_create(100);
+		for (int i = 0; i < n; i++) {
+			bigint_set_word(res[0], i, 0xFFFFFFFFU);
+			bigint_set_word(res[1], i, 0x9E3779B9U * (i + 1));
+		}
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		kar = bigint_get_karatsuba_threshold();
+		nt = bigint_get_ntt_threshold();
+		bigint_set_karatsuba_threshold(4);
+		bigint_set_ntt_threshold(1);
+		bigint_mul(res[0], res[1], res[2]);
+		bigint_set_karatsuba_threshold(kar);
+		bigint_set_ntt_threshold(nt);
+		bigint_mul(res[0], res[1], res[3]);
+		cmp = bigint_compare(res[2], res[3]);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		bigint_destroy(res[3]);
+		return 0;
+	}
+}
+
+int test_mul_threads(int action, void **resources)
+{
+	/* Products split in tasks against those of a single thread,
+	 * Toom, the unbalanced split and the transforms. Without OpenMP
+	 * both sides take the same path.
+	 */
+	int n = 40;
+	bigint_t **res;
+	int cmp = 0;
+	uint32_t kar, t3, t4, nt, pt, th;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(5*sizeof(*res));
+		res[0] = bigint_create(n);
+		res[1] = bigint_create(n);
+		res[2] = bigint_create(2 * n);
+		res[3] = bigint_create(2 * n);
+		res[4] = bigint_create(n);
+		for (int i = 0; i < n; i++) {
+			bigint_set_word(res[0], i, 0x9E3779B9U * (i + 1));
+			bigint_set_word(res[1], i, 0xFFFFFFFFU - i);
+		}
+		for (int i = 0; i < 6; i++)
+			bigint_set_word(res[4], i, 0x7F4A7C15U * (i + 3));
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		kar = bigint_get_karatsuba_threshold();
+		t3 = bigint_get_toom3_threshold();
+		t4 = bigint_get_toom4_threshold();
+		nt = bigint_get_ntt_threshold();
+		pt = bigint_get_parallel_threshold();
+		th = bigint_get_num_threads();
+		bigint_set_karatsuba_threshold(4);
+		bigint_set_toom3_threshold(16);
+		bigint_set_toom4_threshold(32);
+		bigint_set_parallel_threshold(8);
+		for (int k = 0; k < 4 && !cmp; k++) {
+			const bigint_t *x = (k == 1) ? res[4] : res[1];
+			bigint_set_ntt_threshold((k == 2) ? 1 : nt);
+			bigint_set_num_threads(1);
+			if (k == 3)
+				bigint_sqr(res[0], res[2]);
+			else
+				bigint_mul(res[0], x, res[2]);
+			bigint_set_num_threads(4);
+			if (k == 3)
+				bigint_sqr(res[0], res[3]);
+			else
+				bigint_mul(res[0], x, res[3]);
+			cmp = bigint_compare(res[2], res[3]);
+		}
+		bigint_set_num_threads(th);
+		bigint_set_parallel_threshold(pt);
+		bigint_set_karatsuba_threshold(kar);
+		bigint_set_toom3_threshold(t3);
+		bigint_set_toom4_threshold(t4);
+		bigint_set_ntt_threshold(nt);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		bigint_destroy(res[3]);
+		bigint_destroy(res[4]);
+		return 0;
+	}
+}
+
+int test_sqr(int action, void **resources)
+{
+	int n = 12;
+	bigint_t **res;
+	int cmp;
+	uint32_t ks;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(5*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		res[3] = bigint_create(100);
+		res[4] = bigint_create(100);
+		for (int i = 0; i < n; i++)
+			bigint_set_word(res[0], i, 0x9E3779B9U * (i + 1));
+		bigint_copy(res[1], res[0]);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		bigint_sqr(res[0], res[2]);
+		ks = bigint_get_sqr_karatsuba_threshold();
+		bigint_set_sqr_karatsuba_threshold(4);
+		bigint_sqr(res[0], res[3]);
+		bigint_set_sqr_karatsuba_threshold(ks);
+		bigint_mul(res[0], res[1], res[4]);
+		cmp = bigint_compare(res[2], res[4]) ||
+			bigint_compare(res[3], res[4]);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		bigint_destroy(res[3]);
+		bigint_destroy(res[4]);
+		return 0;
+	}
+}
+
+int test_pow(int action, void **resources)
+{
+	bigint_t **res;
+	int cmp, status;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(4*sizeof(*res));
+		res[0] = bigint_create(4);
+		res[1] = bigint_create(4);
+		res[2] = bigint_create(4);
+		res[3] = bigint_create(4);
+		bigint_set_u32(res[1], 1);
+		for (int i = 0; i < 77; i++) {
+			bigint_mul_u32(res[1], 12345, res[2]);
+			bigint_copy(res[1], res[2]);
+		}
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		bigint_set_u32(res[0], 12345);
+		bigint_pow(res[0], 77, res[2]);
+		bigint_set_u32(res[3], 12345);
+		bigint_pow_u64(res[3], 11, res[2], NULL);
+		bigint_pow(res[3], 7, res[2]);
+		cmp = bigint_compare(res[0], res[1]) ||
+			bigint_compare(res[3], res[1]);
+		/* 0 and 1 are their own powers, too large powers are
+		 * rejected and leave big unchanged.
+		 */
+		bigint_set_u32(res[0], 1);
+		bigint_pow_u64(res[0], (uint64_t) 1 << 31, res[2], &status);
+		cmp = cmp || status || bigint_compare_u32(res[0], 1);
+		bigint_set_u32(res[0], 0);
+		bigint_pow_u64(res[0], (uint64_t) 1 << 40, res[2], &status);
+		cmp = cmp || status || !bigint_is_zero(res[0]);
+		bigint_set_u32(res[0], 3);
+		bigint_pow_u64(res[0], (uint64_t) 1 << 32, res[2], &status);
+		cmp = cmp || !status || bigint_compare_u32(res[0], 3);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		bigint_destroy(res[3]);
+		return 0;
+	}
+}
+
+int test_div_words(int action, void **resources)
+{
+	bigint_t **res;
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(5*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		res[3] = bigint_create(100);
+		res[4] = bigint_create(100);
+		for (int i = 0; i < 8; i++)
+			bigint_set_word(res[0], i, 0x9E3779B9U * (i + 1));
+		bigint_set_word(res[1], 0, 0xFFFFFFFFU);
+		bigint_set_word(res[1], 1, 0x12345678U);
+		bigint_set_word(res[1], 2, 0x00C0FFEEU);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		bigint_copy(res[2], res[0]);
+		bigint_div(res[2], res[1], res[3]);
+		cmp = bigint_compare(res[3], res[1]) >= 0;
+		bigint_mul(res[2], res[1], res[4]);
+		bigint_add(res[4], res[3]);
+		cmp |= bigint_compare(res[4], res[0]);
+		bigint_copy(res[4], res[0]);
+		bigint_mod(res[4], res[1], res[2], NULL, NULL);
+		cmp |= bigint_compare(res[4], res[3]);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		bigint_destroy(res[3]);
+		bigint_destroy(res[4]);
+		return 0;
+	}
+}
+
+int test_div_u64(int action, void **resources)
+{
+	uint64_t div = 0xF0E1D2C3B4A59687ULL;
+	bigint_t **res;
+	uint64_t rem;
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(3*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		for (int i = 0; i < 8; i++)
+			bigint_set_word(res[0], i, 0x9E3779B9U * (i + 1));
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		bigint_copy(res[1], res[0]);
+		bigint_div_u64(res[1], div, &rem);
+		bigint_mul_u64(res[1], div, res[2]);
+		bigint_set_u64(res[1], rem);
+		bigint_add(res[2], res[1]);
+		cmp = rem >= div || bigint_compare(res[2], res[0]);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		return 0;
+	}
+}
+
+int test_barrett(int action, void **resources)
+{
+	bigint_t **res;
+	bigint_barrett_t *ctx;
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(6*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		res[3] = bigint_create(100);
+		res[4] = bigint_create(100);
+		res[5] = bigint_create(100);
+		for (int i = 0; i < 6; i++) {
+			bigint_set_word(res[0], i, 0x9E3779B9U * (i + 1));
+			bigint_set_word(res[1], i, 0xFFFFFFFFU - i);
+			bigint_set_word(res[2], i, 0x7F4A7C15U * (i + 3));
+		}
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		ctx = bigint_barrett_create(res[2]);
+		bigint_barrett_mulmod(ctx, res[0], res[1], res[3]);
+		bigint_mul(res[0], res[1], res[4]);
+		bigint_mod(res[4], res[2], res[5], NULL, NULL);
+		cmp = bigint_compare(res[3], res[4]);
+		bigint_mul(res[0], res[1], res[4]);
+		bigint_barrett_reduce(ctx, res[4]);
+		cmp |= bigint_compare(res[3], res[4]);
+		bigint_barrett_destroy(ctx);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		for (int i = 0; i < 6; i++)
+			bigint_destroy(res[i]);
+		return 0;
+	}
+}
+
+int test_powmod(int action, void **resources)
+{
+	/* Fermat's little theorem modulo the prime 2^31 - 1 */
+	uint64_t p = (1ULL << 31) - 1;
+	bigint_t **res;
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(5*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		res[3] = bigint_create(100);
+		res[4] = bigint_create(100);
+		bigint_set_u64(res[0], 0x12345678ULL);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		bigint_set_u64(res[1], p - 1);
+		bigint_set_u64(res[2], p);
+		bigint_powmod(res[0], res[1], res[2], res[3]);
+		cmp = bigint_compare_u32(res[3], 1);
+		bigint_set_u64(res[2], 2 * p);
+		bigint_add_u32(res[1], 1);
+		bigint_powmod(res[0], res[1], res[2], res[3]);
+		bigint_div_u64(res[3], p, &p);
+		cmp |= p != 0x12345678ULL;
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		for (int i = 0; i < 5; i++)
+			bigint_destroy(res[i]);
+		return 0;
+	}
+}
+
+int test_kernels(int action, void **resources)
+{
+	/* Products and squares of every kernel the processor has against
+	 * the C loops, with schoolbook products of 48 words and one of
+	 * 260 words by 48, longer than IFMA takes at once. Setting a
+	 * kernel puts back its thresholds.
+	 */
+	bigint_t **res;
+	int cmp = 0;
+	int status;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(9*sizeof(*res));
+		for (int i = 0; i < 9; i++)
+			res[i] = bigint_create(320);
+		for (int i = 0; i < 48; i++)
+			bigint_set_word(res[0], i, 0x9E3779B9U * (i + 1));
+		for (int i = 0; i < 48; i++)
+			bigint_set_word(res[1], i, 0xFFFFFFFFU - i);
+		for (int i = 0; i < 7; i++)
+			bigint_set_word(res[2], i, 0x7F4A7C15U * (i + 3));
+		for (int i = 0; i < 260; i++)
+			bigint_set_word(res[7], i, 0x6C078965U * (i + 5));
+		bigint_set_kernel(BIGINT_KERNEL_C, NULL);
+		bigint_set_karatsuba_threshold(100);
+		bigint_set_sqr_karatsuba_threshold(100);
+		bigint_mul(res[0], res[1], res[3]);
+		bigint_mul(res[0], res[2], res[4]);
+		bigint_sqr(res[0], res[5]);
+		bigint_mul(res[7], res[1], res[8]);
+		bigint_set_kernel(BIGINT_KERNEL_AUTO, NULL);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		for (int k = BIGINT_KERNEL_ADX; k <= BIGINT_KERNEL_IFMA; k++) {
+			bigint_set_kernel(k, &status);
+			if (status)
+				continue;
+			bigint_set_karatsuba_threshold(100);
+			bigint_set_sqr_karatsuba_threshold(100);
+			bigint_mul(res[0], res[1], res[6]);
+			cmp |= bigint_compare(res[3], res[6]);
+			bigint_mul(res[0], res[2], res[6]);
+			cmp |= bigint_compare(res[4], res[6]);
+			bigint_sqr(res[0], res[6]);
+			cmp |= bigint_compare(res[5], res[6]);
+			bigint_mul(res[7], res[1], res[6]);
+			cmp |= bigint_compare(res[8], res[6]);
+		}
+		bigint_set_kernel(BIGINT_KERNEL_AUTO, NULL);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		for (int i = 0; i < 9; i++)
+			bigint_destroy(res[i]);
+		return 0;
+	}
+}
+
+int test_add_sub(int action, void **resources)
+{
+	bigint_t **res;
+	int status, cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(3*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		/* 2^1280 - 1, every addition carries across all the words */
+		for (int i = 0; i < 40; i++) {
+			bigint_set_word(res[0], i, 0xFFFFFFFFU);
+			bigint_set_word(res[1], i, 0x9E3779B9U * (i + 1));
+		}
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		bigint_copy(res[2], res[0]);
+		bigint_add(res[2], res[1]);
+		bigint_subtract(res[2], res[1], &status);
+		cmp = status || bigint_compare(res[2], res[0]);
+		bigint_add_u64(res[2], 1);
+		cmp |= bigint_compare_2k(res[2], 1280) != 0;
+		bigint_subtract_u32(res[2], 1, &status);
+		cmp |= status || bigint_compare(res[2], res[0]);
+		bigint_copy(res[2], res[1]);
+		bigint_subtract(res[2], res[0], &status);
+		cmp |= !status;
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		return 0;
+	}
+}
+
+int test_decimal_string(int action, void **resources)
+{
+	bigint_t **res;
+	char str[64], nines[64];
+	int cmp;
+	uint32_t dt;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(3*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		res[2] = bigint_create(100);
+		/* 10^60 and 10^60 - 1 */
+		bigint_set_u32(res[0], 10);
+		bigint_pow(res[0], 60, res[2]);
+		bigint_copy(res[1], res[0]);
+		bigint_decrement(res[1]);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		memset(nines, '9', 60);
+		nines[60] = '\0';
+		dt = bigint_get_decimal_threshold();
+		bigint_set_decimal_threshold(2);
+		bigint_get_decimal_string(res[1], str);
+		cmp = strcmp(str, nines);
+		cmp |= bigint_decimal_length_bound(res[1]) < 61;
+		bigint_get_decimal_string(res[0], str);
+		cmp |= str[0] != '1' || strspn(str + 1, "0") != 60 || str[61];
+		bigint_set_decimal_threshold(dt);
+		bigint_get_decimal_string(res[1], str);
+		cmp |= strcmp(str, nines);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		return 0;
+	}
+}
+
+int test_set_decimal(int action, void **resources)
+{
+	const char *dec = "1234567890987654321012345678909876543210"
+		"1234567890987654321012345678909876543210";
+	bigint_t **res;
+	char str[96];
+	int cmp, status;
+	uint32_t dt;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(2*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		dt = bigint_get_decimal_threshold();
+		bigint_set_decimal_threshold(2);
+		bigint_set_decimal(res[0], dec, &status);
+		cmp = status;
+		bigint_set_decimal_threshold(dt);
+		bigint_set_decimal(res[1], dec, &status);
+		cmp |= status;
+		cmp |= bigint_compare(res[0], res[1]);
+		bigint_get_decimal_string(res[0], str);
+		cmp |= strcmp(str, dec);
+		bigint_set_decimal(res[1], "12345x7", &status);
+		cmp |= !status;
+		cmp |= !bigint_is_zero(res[1]);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		return 0;
+	}
+}
+
+int test_hexadec(int action, void **resources)
+{
+	const char *hex = "0000F0e1d2c3b4a5968778695a4b3c2d1e0fFEDCBA9876543210";
+	bigint_t *big;
+	char str[64];
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		big = bigint_create(1);
+		*resources = (void*) big;
+		return 0;
+	case EXECUTE:
+		big = (bigint_t*) *resources;
+		bigint_set_hexadec(big, hex);
+		cmp = bigint_write_hexadec_string(big, str) != 48;
+		cmp |= strcmp(str, "F0E1D2C3B4A5968778695A4B3C2D1E0F"
+			      "FEDCBA9876543210");
+		bigint_set_hexadec(big, "000");
+		cmp |= bigint_write_hexadec_string(big, str) != 1;
+		cmp |= strcmp(str, "0");
+		return cmp;
+	case FREE:
+		big = (bigint_t*) *resources;
+		bigint_destroy(big);
+		return 0;
+	}
+}
+
+int test_arena(int action, void **resources)
+{
+	bigint_t **res;
+	bigint_arena_t *arena;
+	bigint_t *a, *b, *c;
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(2*sizeof(*res));
+		res[0] = bigint_create(100);
+		res[1] = bigint_create(100);
+		for (int i = 0; i < 12; i++) {
+			bigint_set_word(res[0], i, 0xFFFFFFFFU);
+			bigint_set_word(res[1], i, 0x9E3779B9U * (i + 1));
+		}
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		/* Blocks of 64 words, the numbers outgrow them */
+		arena = bigint_arena_create(64);
+		a = bigint_create_in(arena, 1);
+		b = bigint_create_in(arena, 1);
+		c = bigint_create_in(arena, 1);
+		bigint_copy(a, res[0]);
+		bigint_copy(b, res[1]);
+		bigint_mul(a, b, c);
+		bigint_shift_left(c, 3000);
+		bigint_shift_right(c, 3000);
+		bigint_mul(res[0], res[1], a);
+		cmp = bigint_compare(a, c);
+		bigint_destroy(c);
+		bigint_arena_destroy(arena);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		return 0;
+	}
+}
+
+int test_inline_limbs(int action, void **resources)
+{
+	uint64_t x = 0xF0E1D2C3B4A59687ULL;
+	bigint_t *a, *b, *c;
+	uint64_t rem;
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		*resources = NULL;
+		return 0;
+	case EXECUTE:
+		/* c spills to the heap, the power swaps it with b */
+		a = bigint_create(1);
+		b = bigint_create(1);
+		c = bigint_create(1);
+		bigint_set_u64(a, x);
+		bigint_set_u64(b, x);
+		bigint_set_u32(c, 1);
+		bigint_shift_left(c, 1000);
+		bigint_pow(b, 3, c);
+		bigint_div_u64(b, x, &rem);
+		cmp = rem != 0;
+		bigint_div_u64(b, x, &rem);
+		cmp |= rem != 0;
+		cmp |= bigint_compare(a, b);
+		bigint_destroy(a);
+		bigint_destroy(b);
+		bigint_destroy(c);
+		return cmp;
+	case FREE:
+		return 0;
+	}
+}
+
+int test_capacity(int action, void **resources)
+{
+	uint64_t x = 0xF0E1D2C3B4A59687ULL;
+	bigint_t *big;
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		*resources = NULL;
+		return 0;
+	case EXECUTE:
+		big = bigint_create(100);
+		cmp = bigint_capacity(big) < 100;
+		bigint_set_u64(big, x);
+		bigint_shrink_to_fit(big);
+		cmp |= bigint_capacity(big) > 8;
+		bigint_reserve(big, 1000);
+		cmp |= bigint_capacity(big) < 1000;
+		cmp |= bigint_truncate_u64(big) != x;
+		bigint_shift_left(big, 640);
+		bigint_shrink_to_fit(big);
+		cmp |= bigint_capacity(big) != 22;
+		bigint_shift_right(big, 640);
+		cmp |= bigint_truncate_u64(big) != x;
+		bigint_destroy(big);
+		return cmp;
+	case FREE:
+		return 0;
+	}
+}
+
+int test_stale_limbs(int action, void **resources)
+{
+	bigint_t *a, *b, *c;
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		*resources = NULL;
+		return 0;
+	case EXECUTE:
+		/* Limbs above len are left with ones by bigint_set_max,
+		 * the operations that grow a number must not pick them.
+		 */
+		a = bigint_create(64);
+		b = bigint_create(1);
+		c = bigint_create(1);
+		bigint_set_max(a);
+		bigint_set_u32(a, 5);
+		bigint_add_2k(a, 1000);
+		bigint_set_u32(b, 1);
+		bigint_shift_left(b, 1000);
+		bigint_add_u32(b, 5);
+		cmp = bigint_compare(a, b);
+		bigint_set_word(a, 40, 7);
+		bigint_set_u32(c, 7);
+		bigint_shift_left(c, 1280);
+		bigint_add(c, b);
+		cmp |= bigint_compare(a, c);
+
+		bigint_set_max(a);
+		bigint_set_u32(a, 0x80000000);
+		bigint_shift_left(a, 1);
+		cmp |= bigint_compare_2k(a, 32);
+		bigint_set_max(c);
+		bigint_set_u32(c, 0);
+		bigint_mul_u32(a, 3, c);
+		bigint_shift_right(c, 32);
+		cmp |= bigint_compare_u32(c, 3);
+		bigint_set_max(a);
+		bigint_set_u32(a, 0);
+		bigint_set_lsbit(a);
+		cmp |= bigint_compare_u32(a, 1);
+		bigint_destroy(a);
+		bigint_destroy(b);
+		bigint_destroy(c);
+		return cmp;
+	case FREE:
+		return 0;
+	}
+}
+
+int test_sqrt_root(int action, void **resources)
+{
+	bigint_t **res;
+	bigint_t *a, *r, *e;
+	int cmp, status;
+	
+	switch (action) {
+	case ALLOCATE:
+		/* x = 3^200 - 1 and its square and fifth power */
+		res = malloc(3 * sizeof(*res));
+		res[0] = bigint_create(1);
+		res[1] = bigint_create(1);
+		res[2] = bigint_create(1);
+		bigint_set_u32(res[0], 3);
+		bigint_pow(res[0], 200, res[1]);
+		bigint_decrement(res[0]);
+		bigint_sqr(res[0], res[1]);
+		bigint_copy(res[2], res[0]);
+		bigint_pow(res[2], 5, res[1]);
+		bigint_sqr(res[0], res[1]);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		/* x^2 + 2 x has the largest remainder of the root x */
+		a = bigint_clone(res[1]);
+		r = bigint_create(1);
+		bigint_add(a, res[0]);
+		bigint_add(a, res[0]);
+		bigint_sqrt(a, r);
+		cmp = bigint_compare(a, res[0]);
+		bigint_shift_right(r, 1);
+		cmp |= bigint_compare(r, res[0]);
+		cmp |= !bigint_is_perfect_square(res[1]);
+		bigint_copy(a, res[1]);
+		bigint_increment(a);
+		cmp |= bigint_is_perfect_square(a);
+
+		bigint_copy(a, res[2]);
+		bigint_add_u32(a, 7);
+		bigint_root(a, 5, r, NULL);
+		cmp |= bigint_compare(a, res[0]);
+		cmp |= bigint_compare_u32(r, 7);
+		bigint_root(a, 0, r, &status);
+		cmp |= !status || bigint_compare(a, res[0]);
+
+		/* Roots 2^33, 2^65 and 2^66 + 2^33 - 1 and the square of
+		 * 2^64 + 1, which take one from a low limb of 1
+		 */
+		e = bigint_create(1);
+		bigint_set_u32(a, 0);
+		bigint_add_2k(a, 66);
+		bigint_add_2k(a, 34);
+		bigint_sqrt(a, r);
+		cmp |= bigint_compare_2k(a, 33);
+		cmp |= bigint_compare_2k(r, 34);
+		bigint_set_u32(a, 0);
+		bigint_add_2k(a, 130);
+		bigint_add_2k(a, 66);
+		bigint_sqrt(a, r);
+		cmp |= bigint_compare_2k(a, 65);
+		cmp |= bigint_compare_2k(r, 66);
+		bigint_set_u32(a, 0);
+		bigint_add_2k(a, 132);
+		bigint_add_2k(a, 100);
+		bigint_sqrt(a, r);
+		bigint_set_u32(e, 0);
+		bigint_add_2k(e, 66);
+		bigint_add_2k(e, 33);
+		bigint_decrement(e);
+		cmp |= bigint_compare(a, e);
+		bigint_set_u32(e, 0);
+		bigint_add_2k(e, 64);
+		bigint_increment(e);
+		bigint_sqr(e, a);
+		cmp |= !bigint_is_perfect_square(a);
+		bigint_root(a, 2, r, NULL);
+		cmp |= bigint_compare(a, e) || !bigint_is_zero(r);
+		bigint_destroy(a);
+		bigint_destroy(r);
+		bigint_destroy(e);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		free(res);
+		return 0;
+	}
+}
+
+int test_gcd(int action, void **resources)
+{
+	bigint_t **res;
+	bigint_t *g, *s, *t, *u;
+	int cmp, neg, status;
+	
+	switch (action) {
+	case ALLOCATE:
+		/* Fibonacci F(301) and F(300), the worst case of Euclid,
+		 * times 2^127 - 1
+		 */
+		res = malloc(3 * sizeof(*res));
+		res[0] = bigint_create(1);
+		res[1] = bigint_create(1);
+		res[2] = bigint_create(1);
+		bigint_set_u32(res[0], 1);
+		bigint_set_u32(res[1], 0);
+		for (int i = 0; i < 150; i++) {
+			bigint_add(res[1], res[0]);
+			bigint_add(res[0], res[1]);
+		}
+		bigint_set_u32(res[2], 0);
+		bigint_add_2k(res[2], 127);
+		bigint_decrement(res[2]);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		g = bigint_create(1);
+		s = bigint_create(1);
+		t = bigint_create(1);
+		u = bigint_create(1);
+		bigint_mul(res[0], res[2], s);
+		bigint_mul(res[1], res[2], t);
+		bigint_gcd(t, s, g);
+		cmp = bigint_compare(g, res[2]);
+
+		/* g = F(301) s - F(300) t or the opposite */
+		neg = bigint_gcdext(res[0], res[1], g, s, t);
+		cmp |= bigint_compare_u32(g, 1);
+		bigint_mul(res[0], s, neg ? u : g);
+		bigint_mul(res[1], t, neg ? g : u);
+		bigint_subtract(g, u, &status);
+		cmp |= status | bigint_compare_u32(g, 1);
+
+		/* F(300) F(300)^-1 = 1 mod F(301) */
+		bigint_modinv(res[1], res[0], s, &status);
+		cmp |= status;
+		bigint_mul(res[1], s, g);
+		bigint_div(g, res[0], u);
+		cmp |= bigint_compare_u32(u, 1);
+		bigint_modinv(res[2], res[2], s, &status);
+		cmp |= !status;
+		bigint_destroy(g);
+		bigint_destroy(s);
+		bigint_destroy(t);
+		bigint_destroy(u);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		free(res);
+		return 0;
+	}
+}
+
+int test_prime(int action, void **resources)
+{
+	bigint_t **res;
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		/* 2^89 - 1, 25326001 which is a strong probable prime to
+		 * bases 2, 3 and 5, (2^61 - 1) (2^89 - 1), a random prime
+		 * of 80 bits, the prime 12 2^64 + 1 and 4294969489
+		 * 8589938977, a strong probable prime to base 2 without
+		 * factors below 2^16 that the second round rejects
+		 */
+		res = malloc(6 * sizeof(*res));
+		res[0] = bigint_create(1);
+		res[1] = bigint_create(1);
+		res[2] = bigint_create(1);
+		res[3] = bigint_create(1);
+		res[4] = bigint_create(1);
+		res[5] = bigint_create(1);
+		bigint_add_2k(res[0], 89);
+		bigint_decrement(res[0]);
+		bigint_set_u32(res[1], 25326001);
+		bigint_mul_u64(res[0], (1ULL << 61) - 1, res[2]);
+		bigint_get_prime(res[3], 80, test_rng);
+		bigint_set_u64(res[4], 4294969489ULL);
+		bigint_mul_u64(res[4], 8589938977ULL, res[5]);
+		bigint_set_u32(res[4], 0);
+		bigint_add_2k(res[4], 67);
+		bigint_add_2k(res[4], 66);
+		bigint_increment(res[4]);
+		*resources = (void*) res;
+		return bigint_index_of_msbit(res[3]) != 79;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		cmp = !bigint_is_probable_prime(res[0], 1);
+		cmp |= bigint_is_probable_prime(res[1], 1);
+		cmp |= bigint_is_probable_prime(res[2], 1);
+		cmp |= !bigint_is_probable_prime(res[3], 1);
+		cmp |= !bigint_is_probable_prime(res[4], 1);
+		cmp |= bigint_is_probable_prime(res[5], 2);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		bigint_destroy(res[3]);
+		bigint_destroy(res[4]);
+		bigint_destroy(res[5]);
+		free(res);
+		return 0;
+	}
+}
+
+int test_batch(int action, void **resources)
+{
+	bigint_t **res;
+	bigint_batch_t *a, *b, *r;
+	bigint_t *x, *y, *m;
+	int cmp = 0;
+	
+	switch (action) {
+	case ALLOCATE:
+		/* 2^255 - 19 and 20 numbers 3^(150 + j) mod it */
+		res = malloc(21 * sizeof(*res));
+		res[0] = bigint_create(1);
+		bigint_add_2k(res[0], 255);
+		bigint_subtract_u32(res[0], 19, NULL);
+		x = bigint_create(1);
+		for (int j = 1; j <= 20; j++) {
+			res[j] = bigint_create(1);
+			bigint_set_u32(res[j], 3);
+			bigint_pow(res[j], 150 + j, x);
+			bigint_div(res[j], res[0], x);
+			bigint_copy(res[j], x);
+		}
+		bigint_destroy(x);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		a = bigint_batch_create(20, 8);
+		b = bigint_batch_create(20, 8);
+		r = bigint_batch_create(20, 16);
+		x = bigint_create(1);
+		y = bigint_create(1);
+		bigint_batch_load(a, res + 1);
+		for (int j = 0; j < 20; j++)
+			bigint_batch_set(b, j, res[20 - j]);
+
+		/* Number j of each against the same on bigint_t */
+		bigint_batch_mul(a, b, r);
+		for (int j = 0; j < 20; j++) {
+			bigint_mul(res[j + 1], res[20 - j], x);
+			bigint_batch_get(r, j, y);
+			cmp |= bigint_compare(x, y);
+		}
+		bigint_batch_add(a, b, r);
+		for (int j = 0; j < 20; j++) {
+			bigint_copy(x, res[j + 1]);
+			bigint_add(x, res[20 - j]);
+			bigint_batch_get(r, j, y);
+			cmp |= bigint_compare(x, y);
+		}
+		bigint_batch_mulmod(a, b, res[0], a);
+		for (int j = 0; j < 20; j++) {
+			bigint_mul(res[j + 1], res[20 - j], y);
+			bigint_div(y, res[0], x);
+			bigint_batch_get(a, j, y);
+			cmp |= bigint_compare(x, y);
+		}
+
+		/* The same on the even modulus 2 (2^255 - 19) */
+		m = bigint_clone(res[0]);
+		bigint_add(m, res[0]);
+		bigint_batch_load(a, res + 1);
+		bigint_batch_mulmod(a, b, m, r);
+		for (int j = 0; j < 20; j++) {
+			bigint_mul(res[j + 1], res[20 - j], y);
+			bigint_div(y, m, x);
+			bigint_batch_get(r, j, y);
+			cmp |= bigint_compare(x, y);
+		}
+
+		/* Numbers over the odd modulus, a b of 16 words times b */
+		bigint_batch_mul(a, b, r);
+		bigint_batch_mulmod(r, b, res[0], r);
+		for (int j = 0; j < 20; j++) {
+			bigint_mul(res[j + 1], res[20 - j], x);
+			bigint_mul(x, res[20 - j], y);
+			bigint_div(y, res[0], x);
+			bigint_batch_get(r, j, y);
+			cmp |= bigint_compare(x, y);
+		}
+		bigint_batch_destroy(a);
+		bigint_batch_destroy(b);
+		bigint_batch_destroy(r);
+		bigint_destroy(x);
+		bigint_destroy(y);
+		bigint_destroy(m);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		for (int j = 0; j <= 20; j++)
+			bigint_destroy(res[j]);
+		free(res);
+		return 0;
+	}
+}
+
+int test_prod(int action, void **resources)
+{
+	/* 100! against the loop of bigint_mul_u32, C(60, 30), C(100, 3)
+	 * which divides by 3!, the primorial of 50 and 100!^2 from a
+	 * product array
+	 */
+	bigint_t **res;
+	const bigint_t *v[2];
+	int cmp;
+	
+	switch (action) {
+	case ALLOCATE:
+		res = malloc(4 * sizeof(*res));
+		res[0] = bigint_create(1);
+		res[1] = bigint_create(1);
+		res[2] = bigint_create(1);
+		res[3] = bigint_create(1);
+		*resources = (void*) res;
+		return 0;
+	case EXECUTE:
+		res = (bigint_t**) *resources;
+		bigint_factorial(100, res[0]);
+		bigint_set_u32(res[1], 1);
+		for (uint32_t i = 2; i <= 100; i++) {
+			bigint_mul_u32(res[1], i, res[2]);
+			bigint_copy(res[1], res[2]);
+		}
+		cmp = bigint_compare(res[0], res[1]);
+		bigint_binomial(60, 30, res[2]);
+		cmp |= bigint_compare_u64(res[2], 118264581564861424ULL);
+		bigint_binomial(100, 3, res[2]);
+		cmp |= bigint_compare_u32(res[2], 161700);
+		bigint_primorial(50, res[2]);
+		cmp |= bigint_compare_u64(res[2], 614889782588491410ULL);
+		v[0] = res[0];
+		v[1] = res[1];
+		bigint_prod_array(v, 2, res[2]);
+		bigint_sqr(res[0], res[3]);
+		cmp |= bigint_compare(res[2], res[3]);
+		return cmp;
+	case FREE:
+		res = (bigint_t**) *resources;
+		bigint_destroy(res[0]);
+		bigint_destroy(res[1]);
+		bigint_destroy(res[2]);
+		bigint_destroy(res[3]);
+		free(res);
+		return 0;
+	}
+}
+
+static uint64_t test_rng(void)
+{
+	/* xorshift64 */
+	static uint64_t x = 88172645463325252ULL;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}